@@ -34,6 +34,7 @@ public class LlamaCpp : ModuleRules
 			"Core",
 			"CoreUObject",
 			"Engine",
+			"RenderCore",
 			"Projects",
 			"AudioCapture",
 			"AudioCaptureCore",
@@ -0,0 +1,226 @@
+#include "LlamaConversation.h"
+#include "llama.h"
+#include "LlamaCppLog.h"
+
+namespace
+{
+	bool AppendTokens(const llama_vocab* Vocab, const std::string& Text, bool bAddSpecial, TArray<int32>& InOutTokens)
+	{
+		int32_t NTokens = -llama_tokenize(Vocab, Text.c_str(), Text.size(), nullptr, 0, bAddSpecial, true);
+		if (NTokens < 0)
+		{
+			return false;
+		}
+		const int32 Start = InOutTokens.Num();
+		InOutTokens.AddUninitialized(NTokens);
+		if (NTokens > 0)
+		{
+			llama_tokenize(Vocab, Text.c_str(), Text.size(), InOutTokens.GetData() + Start, NTokens, bAddSpecial, true);
+		}
+		return true;
+	}
+
+	bool StartsWith(const std::string& Text, const std::string& Prefix)
+	{
+		return Text.size() >= Prefix.size() && Text.compare(0, Prefix.size(), Prefix) == 0;
+	}
+}
+
+void ULlamaConversation::SetSystemPrompt(const FString& SystemPrompt)
+{
+	if (Messages.Num() > 0 && Messages[0].Role == TEXT("system"))
+	{
+		if (Messages[0].Content != SystemPrompt)
+		{
+			Messages[0].Content = SystemPrompt;
+			InvalidateCache();
+		}
+		return;
+	}
+
+	FLlamaChatMessage Message;
+	Message.Role = TEXT("system");
+	Message.Content = SystemPrompt;
+	Messages.Insert(Message, 0);
+	InvalidateCache();
+}
+
+void ULlamaConversation::AddMessage(const FString& Role, const FString& Content)
+{
+	// Appending keeps the cached prefix valid; BuildPromptTokens only tokenizes the new tail
+	FLlamaChatMessage& Message = Messages.AddDefaulted_GetRef();
+	Message.Role = Role;
+	Message.Content = Content;
+}
+
+void ULlamaConversation::RemoveLastMessage()
+{
+	if (Messages.Num() > 0)
+	{
+		Messages.Pop();
+		InvalidateCache();
+	}
+}
+
+void ULlamaConversation::Clear(bool bKeepSystemPrompt)
+{
+	const bool bHasSystem = Messages.Num() > 0 && Messages[0].Role == TEXT("system");
+	Messages.SetNum(bKeepSystemPrompt && bHasSystem ? 1 : 0);
+	InvalidateCache();
+}
+
+void ULlamaConversation::InvalidateCache()
+{
+	CachedText.clear();
+	CachedTokens.Reset();
+}
+
+bool ULlamaConversation::FormatMessages(const llama_model* Model, int32 NumMessages, bool bAddAssistantPrefix, std::string& OutText) const
+{
+	const int32 Count = NumMessages < 0 ? Messages.Num() : FMath::Min(NumMessages, Messages.Num());
+
+	std::string TemplateUtf8;
+	const char* Template = nullptr;
+	if (!ChatTemplate.IsEmpty())
+	{
+		TemplateUtf8 = TCHAR_TO_UTF8(*ChatTemplate);
+		Template = TemplateUtf8.c_str();
+	}
+	else if (Model)
+	{
+		// Null when the model ships no template; llama_chat_apply_template then falls back to chatml
+		Template = llama_model_chat_template(Model, nullptr);
+	}
+
+	// llama_chat_message only borrows the strings
+	TArray<std::string> Roles;
+	TArray<std::string> Contents;
+	TArray<llama_chat_message> Chat;
+	Roles.Reserve(Count);
+	Contents.Reserve(Count);
+	Chat.SetNum(Count);
+	size_t TotalChars = 0;
+	for (int32 i = 0; i < Count; ++i)
+	{
+		Roles.Add(TCHAR_TO_UTF8(*Messages[i].Role));
+		Contents.Add(TCHAR_TO_UTF8(*Messages[i].Content));
+		Chat[i].role = Roles[i].c_str();
+		Chat[i].content = Contents[i].c_str();
+		TotalChars += Roles[i].size() + Contents[i].size();
+	}
+
+	// Recommended starting size is twice the message text; grow once if the template needs more
+	std::string Buf;
+	Buf.resize(FMath::Max<size_t>(TotalChars * 2, 256));
+	int32_t Len = llama_chat_apply_template(Template, Chat.GetData(), Chat.Num(), bAddAssistantPrefix, Buf.data(), Buf.size());
+	if (Len > static_cast<int32_t>(Buf.size()))
+	{
+		Buf.resize(Len);
+		Len = llama_chat_apply_template(Template, Chat.GetData(), Chat.Num(), bAddAssistantPrefix, Buf.data(), Buf.size());
+	}
+	if (Len < 0)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Chat template is not supported"));
+		return false;
+	}
+
+	Buf.resize(Len);
+	OutText = MoveTemp(Buf);
+	return true;
+}
+
+bool ULlamaConversation::UpdateCachedTokens(const llama_model* Model, std::string& OutHistory)
+{
+	if (Model != CachedModel || ChatTemplate != CachedTemplate)
+	{
+		CachedModel = Model;
+		CachedTemplate = ChatTemplate;
+		InvalidateCache();
+	}
+
+	if (!FormatMessages(Model, -1, false, OutHistory))
+	{
+		return false;
+	}
+
+	// Tokenize only what was appended since the last call
+	const llama_vocab* Vocab = llama_model_get_vocab(Model);
+	if (!CachedText.empty() && StartsWith(OutHistory, CachedText))
+	{
+		if (!AppendTokens(Vocab, OutHistory.substr(CachedText.size()), false, CachedTokens))
+		{
+			InvalidateCache();
+			return false;
+		}
+	}
+	else
+	{
+		CachedTokens.Reset();
+		if (!OutHistory.empty() && !AppendTokens(Vocab, OutHistory, true, CachedTokens))
+		{
+			InvalidateCache();
+			return false;
+		}
+	}
+	CachedText = OutHistory;
+	return true;
+}
+
+bool ULlamaConversation::AppendFormattedTail(const llama_model* Model, const std::string& History, const std::string& Full, TArray<int32>& OutTokens) const
+{
+	const llama_vocab* Vocab = llama_model_get_vocab(Model);
+
+	OutTokens = CachedTokens;
+	if (StartsWith(Full, History))
+	{
+		return AppendTokens(Vocab, Full.substr(History.size()), OutTokens.Num() == 0, OutTokens);
+	}
+
+	// Template rewrites earlier turns when the tail is added; no reuse possible
+	OutTokens.Reset();
+	return AppendTokens(Vocab, Full, true, OutTokens);
+}
+
+bool ULlamaConversation::BuildPromptTokens(const llama_model* Model, TArray<int32>& OutTokens)
+{
+	OutTokens.Reset();
+	if (!Model)
+	{
+		return false;
+	}
+
+	std::string History;
+	std::string Full;
+	if (!UpdateCachedTokens(Model, History) || !FormatMessages(Model, -1, true, Full))
+	{
+		return false;
+	}
+
+	// The assistant prefix is small and tokenized every call
+	return AppendFormattedTail(Model, History, Full, OutTokens) && OutTokens.Num() > 0;
+}
+
+bool ULlamaConversation::BuildPendingTokens(const llama_model* Model, const FString& Role, const FString& Content, TArray<int32>& OutTokens)
+{
+	OutTokens.Reset();
+	if (!Model)
+	{
+		return false;
+	}
+
+	std::string History;
+	if (!UpdateCachedTokens(Model, History))
+	{
+		return false;
+	}
+
+	// Format with the pending message without storing it, so the cached history stays valid
+	FLlamaChatMessage& Pending = Messages.AddDefaulted_GetRef();
+	Pending.Role = Role;
+	Pending.Content = Content;
+	std::string Full;
+	const bool bFormatted = FormatMessages(Model, -1, false, Full);
+	Messages.Pop();
+
+	return bFormatted && AppendFormattedTail(Model, History, Full, OutTokens) && OutTokens.Num() > 0;
+}
@@ -0,0 +1,303 @@
+#include "LlamaCppAudioResampler.h"
+#include "Math/VectorRegister.h"
+#include "HAL/IConsoleManager.h"
+#include "LlamaCppLog.h"
+
+namespace
+{
+	// Rates with a huge reduced up-factor (e.g. 47999 Hz) share this many filter phases instead
+	constexpr int32 MaxPhases = 1024;
+
+	// Passband edge as a fraction of the lower Nyquist frequency
+	constexpr double Rolloff = 0.92;
+	constexpr double KaiserBeta = 8.0;
+
+	double BesselI0(double X)
+	{
+		double Sum = 1.0;
+		double Term = 1.0;
+		const double HalfX = X * 0.5;
+		for (int32 k = 1; k < 32; ++k)
+		{
+			Term *= (HalfX / k) * (HalfX / k);
+			Sum += Term;
+			if (Term < Sum * 1e-12)
+			{
+				break;
+			}
+		}
+		return Sum;
+	}
+
+	/** Num must be a multiple of 4. */
+	FORCEINLINE float DotProduct(const float* X, const float* C, int32 Num)
+	{
+		VectorRegister4Float Acc0 = VectorZeroFloat();
+		VectorRegister4Float Acc1 = VectorZeroFloat();
+		int32 i = 0;
+		for (; i + 8 <= Num; i += 8)
+		{
+			Acc0 = VectorMultiplyAdd(VectorLoad(X + i), VectorLoad(C + i), Acc0);
+			Acc1 = VectorMultiplyAdd(VectorLoad(X + i + 4), VectorLoad(C + i + 4), Acc1);
+		}
+		for (; i < Num; i += 4)
+		{
+			Acc0 = VectorMultiplyAdd(VectorLoad(X + i), VectorLoad(C + i), Acc0);
+		}
+
+		alignas(16) float Lanes[4];
+		VectorStoreAligned(VectorAdd(Acc0, Acc1), Lanes);
+		return (Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3]);
+	}
+}
+
+void FLlamaAudioResampler::Init(int32 InSampleRate, int32 InChannels, int32 OutSampleRate, int32 TapsPerPhase)
+{
+	InSampleRate = FMath::Max(InSampleRate, 1);
+	InChannels = FMath::Max(InChannels, 1);
+	OutSampleRate = FMath::Max(OutSampleRate, 1);
+	const int32 Taps = FMath::Clamp(Align(TapsPerPhase, 4), 8, 256);
+
+	if (InSampleRate == InRate && InChannels == InNumChannels && OutSampleRate == OutRate && Taps == NumTaps)
+	{
+		return;
+	}
+
+	InRate = InSampleRate;
+	OutRate = OutSampleRate;
+	InNumChannels = InChannels;
+	NumTaps = Taps;
+
+	const int32 Divisor = FMath::GreatestCommonDivisor(InRate, OutRate);
+	UpFactor = OutRate / Divisor;
+	DownFactor = InRate / Divisor;
+	NumPhases = FMath::Min(UpFactor, MaxPhases);
+
+	BuildFilter();
+	Reset();
+}
+
+void FLlamaAudioResampler::Reset()
+{
+	Work.Reset();
+	Work.SetNumZeroed(NumTaps > 0 ? NumTaps - 1 : 0);
+	NextIndex = Work.Num();
+	NextPhase = 0;
+}
+
+void FLlamaAudioResampler::BuildFilter()
+{
+	Coefficients.Reset();
+	if (UpFactor == DownFactor)
+	{
+		return;
+	}
+
+	// Kernel in input-sample time, low-passed below the lower of the two Nyquist frequencies
+	const double Cutoff = 0.5 * FMath::Min(1.0, static_cast<double>(UpFactor) / DownFactor) * Rolloff;
+	const double HalfWidth = NumTaps * 0.5;
+	const double WindowNorm = BesselI0(KaiserBeta);
+
+	Coefficients.SetNumUninitialized(NumPhases * NumTaps);
+	for (int32 Phase = 0; Phase < NumPhases; ++Phase)
+	{
+		const double Frac = static_cast<double>(Phase) / NumPhases;
+		float* Row = Coefficients.GetData() + Phase * NumTaps;
+		double Sum = 0.0;
+
+		for (int32 j = 0; j < NumTaps; ++j)
+		{
+			// Row[j] multiplies the input NumTaps - 1 - j samples before the newest one
+			const double Tau = Frac + (NumTaps - 1 - j) - HalfWidth + 1.0;
+			const double X = 2.0 * Cutoff * Tau;
+			const double Sinc = FMath::IsNearlyZero(X) ? 1.0 : FMath::Sin(UE_DOUBLE_PI * X) / (UE_DOUBLE_PI * X);
+			const double R = Tau / HalfWidth;
+			const double Window = FMath::Abs(R) >= 1.0 ? 0.0 : BesselI0(KaiserBeta * FMath::Sqrt(1.0 - R * R)) / WindowNorm;
+			const double Value = 2.0 * Cutoff * Sinc * Window;
+			Row[j] = static_cast<float>(Value);
+			Sum += Value;
+		}
+
+		// Unity DC gain on every phase, so a constant input stays constant
+		if (Sum != 0.0)
+		{
+			for (int32 j = 0; j < NumTaps; ++j)
+			{
+				Row[j] = static_cast<float>(Row[j] / Sum);
+			}
+		}
+	}
+}
+
+void FLlamaAudioResampler::AppendMono(const float* In, int32 NumFrames, TArray<float>& Out) const
+{
+	if (InNumChannels == 1)
+	{
+		Out.Append(In, NumFrames);
+		return;
+	}
+
+	const int32 Start = Out.AddUninitialized(NumFrames);
+	float* Dst = Out.GetData() + Start;
+
+	if (InNumChannels == 2)
+	{
+		const VectorRegister4Float Half = VectorSetFloat1(0.5f);
+		int32 i = 0;
+		for (; i + 4 <= NumFrames; i += 4)
+		{
+			const VectorRegister4Float A = VectorLoad(In + i * 2);
+			const VectorRegister4Float B = VectorLoad(In + i * 2 + 4);
+			const VectorRegister4Float Left = VectorShuffle(A, B, 0, 2, 0, 2);
+			const VectorRegister4Float Right = VectorShuffle(A, B, 1, 3, 1, 3);
+			VectorStore(VectorMultiply(VectorAdd(Left, Right), Half), Dst + i);
+		}
+		for (; i < NumFrames; ++i)
+		{
+			Dst[i] = (In[i * 2] + In[i * 2 + 1]) * 0.5f;
+		}
+		return;
+	}
+
+	const float Scale = 1.0f / InNumChannels;
+	for (int32 i = 0; i < NumFrames; ++i)
+	{
+		const float* Frame = In + i * InNumChannels;
+		float Sum = 0.0f;
+		for (int32 c = 0; c < InNumChannels; ++c)
+		{
+			Sum += Frame[c];
+		}
+		Dst[i] = Sum * Scale;
+	}
+}
+
+void FLlamaAudioResampler::Process(const float* In, int32 NumFrames, TArray<float>& Out)
+{
+	if (!IsInitialized() || !In || NumFrames <= 0)
+	{
+		return;
+	}
+
+	if (UpFactor == DownFactor)
+	{
+		// Same rate: downmix straight into the output
+		AppendMono(In, NumFrames, Out);
+		return;
+	}
+
+	AppendMono(In, NumFrames, Work);
+
+	const int32 Available = Work.Num();
+	Out.Reserve(Out.Num() + static_cast<int32>(static_cast<int64>(NumFrames) * UpFactor / DownFactor) + 2);
+
+	const float* WorkData = Work.GetData();
+	const float* CoefData = Coefficients.GetData();
+	while (NextIndex < Available)
+	{
+		const int32 Row = NumPhases == UpFactor ? NextPhase : static_cast<int32>(static_cast<int64>(NextPhase) * NumPhases / UpFactor);
+		Out.Add(DotProduct(WorkData + NextIndex - (NumTaps - 1), CoefData + Row * NumTaps, NumTaps));
+
+		NextPhase += DownFactor;
+		NextIndex += NextPhase / UpFactor;
+		NextPhase %= UpFactor;
+	}
+
+	// Keep NumTaps - 1 samples of history in front of the next output
+	const int32 Drop = FMath::Min(NextIndex, Available) - (NumTaps - 1);
+	if (Drop > 0)
+	{
+		Work.RemoveAt(0, Drop);
+		NextIndex -= Drop;
+	}
+}
+
+void FLlamaAudioResampler::Convert(const float* In, int32 NumFrames, int32 InSampleRate, int32 InChannels, int32 OutSampleRate, TArray<float>& Out)
+{
+	Out.Reset();
+	if (!In || NumFrames <= 0 || InSampleRate <= 0 || InChannels <= 0 || OutSampleRate <= 0)
+	{
+		return;
+	}
+
+	FLlamaAudioResampler Resampler;
+	Resampler.Init(InSampleRate, InChannels, OutSampleRate);
+	Resampler.Process(In, NumFrames, Out);
+}
+
+#if !UE_BUILD_SHIPPING
+namespace
+{
+	/** The per-sample linear interpolation every audio path used before, kept as the benchmark baseline. */
+	void LinearResampleBaseline(const float* In, int32 NumFrames, int32 InRate, int32 NumChannels, int32 OutRate, TArray<float>& Out)
+	{
+		TArray<float> Mono;
+		Mono.SetNumUninitialized(NumFrames);
+		for (int32 i = 0; i < NumFrames; ++i)
+		{
+			float Sum = 0.0f;
+			for (int32 c = 0; c < NumChannels; ++c)
+			{
+				Sum += In[i * NumChannels + c];
+			}
+			Mono[i] = Sum / static_cast<float>(NumChannels);
+		}
+
+		const double Ratio = static_cast<double>(OutRate) / static_cast<double>(InRate);
+		const int32 OutNumFrames = static_cast<int32>(NumFrames * Ratio);
+		Out.SetNumUninitialized(OutNumFrames);
+		for (int32 i = 0; i < OutNumFrames; ++i)
+		{
+			const double SrcIndex = static_cast<double>(i) / Ratio;
+			const int32 Idx0 = static_cast<int32>(SrcIndex);
+			const int32 Idx1 = FMath::Min(Idx0 + 1, NumFrames - 1);
+			const double Frac = SrcIndex - static_cast<double>(Idx0);
+			Out[i] = static_cast<float>(Mono[Idx0] * (1.0 - Frac) + Mono[Idx1] * Frac);
+		}
+	}
+
+	void BenchmarkResampler(int32 InRate, int32 NumChannels, int32 OutRate)
+	{
+		constexpr float Seconds = 60.0f;
+		const int32 NumFrames = static_cast<int32>(Seconds * InRate);
+		const int32 ChunkFrames = InRate / 100; // 10 ms device callbacks
+
+		TArray<float> Input;
+		Input.SetNumUninitialized(NumFrames * NumChannels);
+		FRandomStream Random(1234);
+		for (float& Sample : Input)
+		{
+			Sample = Random.FRandRange(-0.5f, 0.5f);
+		}
+
+		TArray<float> Output;
+		double Start = FPlatformTime::Seconds();
+		LinearResampleBaseline(Input.GetData(), NumFrames, InRate, NumChannels, OutRate, Output);
+		const double LinearMs = (FPlatformTime::Seconds() - Start) * 1000.0;
+
+		Output.Reset();
+		Start = FPlatformTime::Seconds();
+		FLlamaAudioResampler Resampler;
+		Resampler.Init(InRate, NumChannels, OutRate);
+		for (int32 Frame = 0; Frame < NumFrames; Frame += ChunkFrames)
+		{
+			Resampler.Process(Input.GetData() + Frame * NumChannels, FMath::Min(ChunkFrames, NumFrames - Frame), Output);
+		}
+		const double PolyphaseMs = (FPlatformTime::Seconds() - Start) * 1000.0;
+
+		UE_LOG(LogLlamaCpp, Display, TEXT("LlamaCpp: Resample %.0fs %d Hz x%d -> %d Hz: linear (whole buffer) %.2f ms, polyphase (10 ms chunks) %.2f ms, %.0fx realtime, %d samples out"),
+			Seconds, InRate, NumChannels, OutRate, LinearMs, PolyphaseMs, Seconds * 1000.0 / FMath::Max(PolyphaseMs, 0.001), Output.Num());
+	}
+
+	FAutoConsoleCommand BenchmarkResamplerCommand(
+		TEXT("LlamaCpp.BenchmarkResampler"),
+		TEXT("Time the polyphase audio resampler against plain linear interpolation on common capture and TTS rates."),
+		FConsoleCommandDelegate::CreateStatic([]()
+		{
+			BenchmarkResampler(48000, 2, 16000);
+			BenchmarkResampler(48000, 1, 16000);
+			BenchmarkResampler(44100, 2, 16000);
+			BenchmarkResampler(22050, 1, 48000);
+		}));
+}
+#endif
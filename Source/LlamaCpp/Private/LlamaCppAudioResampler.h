@@ -0,0 +1,59 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Windowed-sinc polyphase resampler with a fused downmix to mono, shared by every audio path in the
+ * plugin (whisper capture and WAV loading, sherpa capture, TTS output). Filter history and phase are
+ * kept between Process calls, so a stream can be fed in chunks of any size without seams. Inner loops
+ * use the engine's VectorRegister (SSE on x64, NEON on ARM). Not thread-safe; use one per stream.
+ *
+ * Output lags the input by half the filter length (TapsPerPhase / 2 input samples, well under 1 ms).
+ */
+class FLlamaAudioResampler
+{
+public:
+	/** Configure for interleaved InNumChannels at InSampleRate to mono at OutSampleRate. A no-op if nothing changed. */
+	void Init(int32 InSampleRate, int32 InNumChannels, int32 OutSampleRate, int32 TapsPerPhase = 32);
+
+	/** Forget stream history; the next Process starts a fresh stream with the same settings. */
+	void Reset();
+
+	/** Convert NumFrames interleaved frames and append the mono result to Out. */
+	void Process(const float* In, int32 NumFrames, TArray<float>& Out);
+
+	bool IsInitialized() const { return InNumChannels > 0; }
+	bool IsPassthrough() const { return InNumChannels == 1 && UpFactor == DownFactor; }
+
+	/** One-shot conversion of a whole buffer; Out is overwritten. */
+	static void Convert(const float* In, int32 NumFrames, int32 InSampleRate, int32 InNumChannels, int32 OutSampleRate, TArray<float>& Out);
+
+	static void Convert(const TArray<float>& In, int32 InSampleRate, int32 InNumChannels, int32 OutSampleRate, TArray<float>& Out)
+	{
+		Convert(In.GetData(), In.Num() / FMath::Max(InNumChannels, 1), InSampleRate, InNumChannels, OutSampleRate, Out);
+	}
+
+private:
+	int32 InRate = 0;
+	int32 OutRate = 0;
+	int32 InNumChannels = 0;
+
+	// Output rate / input rate == UpFactor / DownFactor, reduced
+	int32 UpFactor = 1;
+	int32 DownFactor = 1;
+	int32 NumTaps = 0;
+	int32 NumPhases = 0;
+
+	/** NumPhases rows of NumTaps coefficients, each row reversed so it dots with contiguous input. */
+	TArray<float> Coefficients;
+
+	/** Mono input: NumTaps - 1 samples of history followed by samples not consumed yet. */
+	TArray<float> Work;
+
+	/** Newest input sample (index into Work) under the next output, and its sub-sample phase in [0, UpFactor). */
+	int32 NextIndex = 0;
+	int32 NextPhase = 0;
+
+	void BuildFilter();
+	void AppendMono(const float* In, int32 NumFrames, TArray<float>& Out) const;
+};
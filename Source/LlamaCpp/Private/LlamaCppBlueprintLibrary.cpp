@@ -1,5 +1,11 @@
 #include "LlamaCppBlueprintLibrary.h"
 #include "LlamaCppInference.h"
+#include "LlamaCppEmbedder.h"
+#include "LlamaCppVectorStore.h"
+#include "LlamaCppSemanticCache.h"
+#include "LlamaConversation.h"
+#include "LlamaCppRouter.h"
+#include "LlamaCppLogitFilter.h"
 #include "WhisperCppTranscription.h"
 #include "SherpaOnnxTextToSpeech.h"
 #include "SherpaOnnxTranscription.h"
@@ -17,6 +23,78 @@ ULlamaCppInference* ULlamaCppBlueprintLibrary::CreateLlamaCppInference(UObject*
 	return Inference;
 }
 
+ULlamaCppEmbedder* ULlamaCppBlueprintLibrary::CreateLlamaCppEmbedder(UObject* WorldContextObject)
+{
+	if (!WorldContextObject)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: CreateLlamaCppEmbedder called with null WorldContextObject"));
+		return nullptr;
+	}
+
+	ULlamaCppEmbedder* Embedder = NewObject<ULlamaCppEmbedder>(WorldContextObject);
+	return Embedder;
+}
+
+ULlamaCppVectorStore* ULlamaCppBlueprintLibrary::CreateLlamaCppVectorStore(UObject* WorldContextObject)
+{
+	if (!WorldContextObject)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: CreateLlamaCppVectorStore called with null WorldContextObject"));
+		return nullptr;
+	}
+
+	ULlamaCppVectorStore* Store = NewObject<ULlamaCppVectorStore>(WorldContextObject);
+	return Store;
+}
+
+ULlamaCppSemanticCache* ULlamaCppBlueprintLibrary::CreateLlamaCppSemanticCache(UObject* WorldContextObject)
+{
+	if (!WorldContextObject)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: CreateLlamaCppSemanticCache called with null WorldContextObject"));
+		return nullptr;
+	}
+
+	ULlamaCppSemanticCache* Cache = NewObject<ULlamaCppSemanticCache>(WorldContextObject);
+	return Cache;
+}
+
+ULlamaConversation* ULlamaCppBlueprintLibrary::CreateLlamaConversation(UObject* WorldContextObject)
+{
+	if (!WorldContextObject)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: CreateLlamaConversation called with null WorldContextObject"));
+		return nullptr;
+	}
+
+	ULlamaConversation* Conversation = NewObject<ULlamaConversation>(WorldContextObject);
+	return Conversation;
+}
+
+ULlamaCppRouter* ULlamaCppBlueprintLibrary::CreateLlamaCppRouter(UObject* WorldContextObject)
+{
+	if (!WorldContextObject)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: CreateLlamaCppRouter called with null WorldContextObject"));
+		return nullptr;
+	}
+
+	ULlamaCppRouter* Router = NewObject<ULlamaCppRouter>(WorldContextObject);
+	return Router;
+}
+
+ULlamaCppLogitFilter* ULlamaCppBlueprintLibrary::CreateLlamaCppLogitFilter(UObject* WorldContextObject)
+{
+	if (!WorldContextObject)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: CreateLlamaCppLogitFilter called with null WorldContextObject"));
+		return nullptr;
+	}
+
+	ULlamaCppLogitFilter* Filter = NewObject<ULlamaCppLogitFilter>(WorldContextObject);
+	return Filter;
+}
+
 UWhisperCppTranscription* ULlamaCppBlueprintLibrary::CreateWhisperTranscription(UObject* WorldContextObject)
 {
 	if (!WorldContextObject)
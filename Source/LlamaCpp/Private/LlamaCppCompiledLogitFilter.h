@@ -0,0 +1,24 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "llama.h"
+
+/** Token-level form of a ULlamaCppLogitFilter for one model. Immutable once built; shared with worker threads. */
+struct FLlamaCompiledLogitFilter
+{
+	// Hash of the filter's lists, stable across recompiles so caches can key on it
+	uint64 SourceHash = 0;
+
+	TArray<llama_logit_bias> Biases;
+
+	// Banned phrases of two or more tokens
+	TArray<TArray<llama_token>> BannedSequences;
+
+	// Index into BannedSequences by each sequence's second-to-last token
+	TMultiMap<llama_token, int32> SequencesByLastPrefixToken;
+
+	int32 MaxSequenceLength = 0;
+};
+
+/** Add the bias and banned-phrase stages for Filter to Chain. */
+void AddLogitFilterSamplers(llama_sampler* Chain, const TSharedPtr<const FLlamaCompiledLogitFilter, ESPMode::ThreadSafe>& Filter, int32 NumVocab);
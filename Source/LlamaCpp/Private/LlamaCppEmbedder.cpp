@@ -0,0 +1,442 @@
+#include "LlamaCppEmbedder.h"
+#include "Async/Async.h"
+#include "Hash/CityHash.h"
+#include "Misc/Paths.h"
+#include "llama.h"
+#include <string>
+#include "LlamaCppLog.h"
+
+namespace
+{
+	enum llama_pooling_type ToLlamaPooling(ELlamaPoolingType PoolingType)
+	{
+		switch (PoolingType)
+		{
+		case ELlamaPoolingType::Mean: return LLAMA_POOLING_TYPE_MEAN;
+		case ELlamaPoolingType::Cls:  return LLAMA_POOLING_TYPE_CLS;
+		case ELlamaPoolingType::Last: return LLAMA_POOLING_TYPE_LAST;
+		case ELlamaPoolingType::Rank: return LLAMA_POOLING_TYPE_RANK;
+		default:                      return LLAMA_POOLING_TYPE_UNSPECIFIED;
+		}
+	}
+
+	/** Run one packed batch through the model. Encoder-only models have no KV memory and use llama_encode. */
+	bool RunBatch(llama_context* Ctx, const llama_batch& Batch)
+	{
+		const llama_model* Model = llama_get_model(Ctx);
+		llama_memory_clear(llama_get_memory(Ctx), true);
+
+		if (llama_model_has_encoder(Model) && !llama_model_has_decoder(Model))
+		{
+			return llama_encode(Ctx, Batch) == 0;
+		}
+		return llama_decode(Ctx, Batch) == 0;
+	}
+}
+
+ULlamaCppEmbedder::ULlamaCppEmbedder()
+{
+	EmbedDoneEvent = FPlatformProcess::GetSynchEventFromPool(false);
+}
+
+void ULlamaCppEmbedder::BeginDestroy()
+{
+	while (PendingEmbeds > 0)
+	{
+		EmbedDoneEvent->Wait(100);
+	}
+
+	UnloadModel();
+
+	FPlatformProcess::ReturnSynchEventToPool(EmbedDoneEvent);
+	EmbedDoneEvent = nullptr;
+
+	Super::BeginDestroy();
+}
+
+void ULlamaCppEmbedder::LoadModel(const FString& ModelPath, int32 ContextSize, ELlamaPoolingType PoolingType)
+{
+	if (Model)
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Embedding model already loaded, unloading first"));
+		UnloadModel();
+	}
+
+	TWeakObjectPtr<ULlamaCppEmbedder> WeakThis(this);
+	FString PathCopy = ModelPath;
+	int32 NumSequences = FMath::Clamp(MaxParallelSequences, 1, static_cast<int32>(llama_max_parallel_sequences()));
+	enum llama_pooling_type Pooling = ToLlamaPooling(PoolingType);
+
+	Async(EAsyncExecution::Thread, [WeakThis, PathCopy, ContextSize, NumSequences, Pooling]()
+	{
+		llama_model_params ModelParams = llama_model_default_params();
+		ModelParams.n_gpu_layers = 0; // CPU-only on Quest 3
+
+		llama_model* LoadedModel = llama_model_load_from_file(TCHAR_TO_UTF8(*PathCopy), ModelParams);
+		llama_context* LoadedCtx = nullptr;
+
+		if (LoadedModel)
+		{
+			llama_context_params CtxParams = llama_context_default_params();
+			CtxParams.n_ctx = ContextSize;
+			// Non-causal models must see a whole sequence in one ubatch
+			CtxParams.n_batch = ContextSize;
+			CtxParams.n_ubatch = ContextSize;
+			CtxParams.n_seq_max = NumSequences;
+			CtxParams.kv_unified = true; // let any single text use the whole context
+			CtxParams.embeddings = true;
+			CtxParams.pooling_type = Pooling;
+			CtxParams.no_perf = true;
+
+			LoadedCtx = llama_init_from_model(LoadedModel, CtxParams);
+			if (!LoadedCtx)
+			{
+				UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to create embedding context"));
+				llama_model_free(LoadedModel);
+				LoadedModel = nullptr;
+			}
+			else if (llama_pooling_type(LoadedCtx) == LLAMA_POOLING_TYPE_NONE)
+			{
+				UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Embedding model has no pooling — choose Mean, Cls or Last"));
+				llama_free(LoadedCtx);
+				llama_model_free(LoadedModel);
+				LoadedCtx = nullptr;
+				LoadedModel = nullptr;
+			}
+		}
+		else
+		{
+			UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to load embedding model from %s"), *PathCopy);
+		}
+
+		const bool bSuccess = (LoadedModel != nullptr);
+
+		// File name rather than full path, so a cache saved on one machine still matches the same model on another
+		uint64 Identity = 0;
+		if (bSuccess)
+		{
+			char Desc[256];
+			llama_model_desc(LoadedModel, Desc, sizeof(Desc));
+			const FString IdentityString = FString::Printf(TEXT("%s|%s|%llu|%llu|%d"), *FPaths::GetCleanFilename(PathCopy), UTF8_TO_TCHAR(Desc),
+				static_cast<unsigned long long>(llama_model_n_params(LoadedModel)), static_cast<unsigned long long>(llama_model_size(LoadedModel)),
+				static_cast<int32>(llama_pooling_type(LoadedCtx)));
+			Identity = CityHash64(reinterpret_cast<const char*>(*IdentityString), IdentityString.Len() * sizeof(TCHAR));
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, LoadedModel, LoadedCtx, Identity, bSuccess]()
+		{
+			if (ULlamaCppEmbedder* Self = WeakThis.Get())
+			{
+				if (bSuccess)
+				{
+					FScopeLock Lock(&Self->ContextLock);
+					Self->Model = LoadedModel;
+					Self->Ctx = LoadedCtx;
+					Self->Vocab = llama_model_get_vocab(LoadedModel);
+					Self->ModelIdentity = Identity;
+					Self->bRankPooling = llama_pooling_type(LoadedCtx) == LLAMA_POOLING_TYPE_RANK;
+					Self->ClassLabels.Reset();
+
+					if (Self->bRankPooling)
+					{
+						// Rank pooling yields one score per classifier output instead of an embedding
+						const int32 NumOutputs = FMath::Max(1, static_cast<int32>(llama_model_n_cls_out(LoadedModel)));
+						for (int32 i = 0; i < NumOutputs; ++i)
+						{
+							const char* Label = llama_model_cls_label(LoadedModel, i);
+							Self->ClassLabels.Add(Label ? FString(UTF8_TO_TCHAR(Label)) : FString::Printf(TEXT("LABEL_%d"), i));
+						}
+						Self->EmbeddingSize = NumOutputs;
+					}
+					else
+					{
+						Self->EmbeddingSize = llama_model_n_embd(LoadedModel);
+					}
+					UE_LOG(LogLlamaCpp, Log, TEXT("LlamaCpp: Embedding model loaded (%s=%d)"),
+						Self->bRankPooling ? TEXT("n_cls_out") : TEXT("n_embd"), Self->EmbeddingSize);
+				}
+				Self->OnModelLoaded.Broadcast(bSuccess);
+			}
+			else if (bSuccess)
+			{
+				llama_free(LoadedCtx);
+				llama_model_free(LoadedModel);
+			}
+		});
+	});
+}
+
+void ULlamaCppEmbedder::UnloadModel()
+{
+	FScopeLock Lock(&ContextLock);
+
+	if (Ctx)
+	{
+		llama_free(Ctx);
+		Ctx = nullptr;
+	}
+	if (Model)
+	{
+		llama_model_free(Model);
+		Model = nullptr;
+	}
+	Vocab = nullptr;
+	EmbeddingSize = 0;
+	ModelIdentity = 0;
+	bRankPooling = false;
+	ClassLabels.Reset();
+}
+
+bool ULlamaCppEmbedder::IsModelLoaded() const
+{
+	return Model != nullptr && Ctx != nullptr;
+}
+
+int32 ULlamaCppEmbedder::GetEmbeddingSize() const
+{
+	return EmbeddingSize;
+}
+
+bool ULlamaCppEmbedder::EmbedBlocking(const TArray<FString>& Texts, TArray<TArray<float>>& OutVectors)
+{
+	FScopeLock Lock(&ContextLock);
+
+	OutVectors.Reset();
+	if (!Ctx || !Vocab)
+	{
+		return false;
+	}
+
+	const int32 BatchSize = static_cast<int32>(llama_n_batch(Ctx));
+	const int32 MaxSeqs = static_cast<int32>(llama_n_seq_max(Ctx));
+
+	// Tokenize everything up front so the packing loop knows each text's length
+	TArray<TArray<llama_token>> AllTokens;
+	AllTokens.SetNum(Texts.Num());
+	for (int32 i = 0; i < Texts.Num(); ++i)
+	{
+		std::string TextUtf8 = TCHAR_TO_UTF8(*Texts[i]);
+		TArray<llama_token>& Tokens = AllTokens[i];
+		int32_t NTokens = -llama_tokenize(Vocab, TextUtf8.c_str(), TextUtf8.size(), nullptr, 0, true, true);
+		Tokens.SetNum(FMath::Max(NTokens, 0));
+		if (NTokens > 0)
+		{
+			llama_tokenize(Vocab, TextUtf8.c_str(), TextUtf8.size(), Tokens.GetData(), Tokens.Num(), true, true);
+		}
+		if (Tokens.Num() > BatchSize)
+		{
+			UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Text %d has %d tokens, truncating to %d"), i, Tokens.Num(), BatchSize);
+			Tokens.SetNum(BatchSize);
+		}
+	}
+
+	OutVectors.SetNum(Texts.Num());
+	llama_batch Batch = llama_batch_init(BatchSize, 0, 1);
+	bool bOk = true;
+
+	int32 Next = 0;
+	while (Next < Texts.Num() && bOk)
+	{
+		const int32 First = Next;
+		Batch.n_tokens = 0;
+
+		while (Next < Texts.Num() && Next - First < MaxSeqs && Batch.n_tokens + AllTokens[Next].Num() <= BatchSize)
+		{
+			const TArray<llama_token>& Tokens = AllTokens[Next];
+			const llama_seq_id SeqId = Next - First;
+			for (int32 k = 0; k < Tokens.Num(); ++k)
+			{
+				const int32 Idx = Batch.n_tokens++;
+				Batch.token[Idx] = Tokens[k];
+				Batch.pos[Idx] = k;
+				Batch.n_seq_id[Idx] = 1;
+				Batch.seq_id[Idx][0] = SeqId;
+				Batch.logits[Idx] = true;
+			}
+			++Next;
+		}
+
+		if (Batch.n_tokens > 0 && !RunBatch(Ctx, Batch))
+		{
+			UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to decode embedding batch"));
+			bOk = false;
+			break;
+		}
+
+		for (int32 i = First; i < Next; ++i)
+		{
+			TArray<float>& Vector = OutVectors[i];
+			Vector.SetNumZeroed(EmbeddingSize);
+
+			const float* Embd = AllTokens[i].Num() > 0 ? llama_get_embeddings_seq(Ctx, i - First) : nullptr;
+			if (!Embd)
+			{
+				continue;
+			}
+
+			FMemory::Memcpy(Vector.GetData(), Embd, EmbeddingSize * sizeof(float));
+			if (bNormalize && !bRankPooling)
+			{
+				double SumSquares = 0.0;
+				for (float V : Vector)
+				{
+					SumSquares += V * V;
+				}
+				const float InvNorm = SumSquares > 0.0 ? static_cast<float>(1.0 / FMath::Sqrt(SumSquares)) : 0.0f;
+				for (float& V : Vector)
+				{
+					V *= InvNorm;
+				}
+			}
+		}
+	}
+
+	llama_batch_free(Batch);
+
+	if (!bOk)
+	{
+		OutVectors.Reset();
+	}
+	return bOk;
+}
+
+void ULlamaCppEmbedder::EmbedAsync(const TArray<FString>& Texts)
+{
+	if (!IsModelLoaded())
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Cannot embed — no embedding model loaded"));
+		OnEmbeddingsComputed.Broadcast(TArray<FLlamaEmbedding>());
+		return;
+	}
+
+	TWeakObjectPtr<ULlamaCppEmbedder> WeakThis(this);
+	RunPendingWork([this, WeakThis, TextsCopy = Texts]()
+	{
+		TArray<TArray<float>> Vectors;
+		EmbedBlocking(TextsCopy, Vectors);
+
+		TArray<FLlamaEmbedding> Embeddings;
+		Embeddings.SetNum(Vectors.Num());
+		for (int32 i = 0; i < Vectors.Num(); ++i)
+		{
+			Embeddings[i].Vector = MoveTemp(Vectors[i]);
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Embeddings = MoveTemp(Embeddings)]()
+		{
+			if (ULlamaCppEmbedder* Owner = WeakThis.Get())
+			{
+				Owner->OnEmbeddingsComputed.Broadcast(Embeddings);
+			}
+		});
+	});
+}
+
+bool ULlamaCppEmbedder::ClassifyBlocking(const TArray<FString>& Texts, TArray<FLlamaClassification>& OutResults)
+{
+	OutResults.Reset();
+
+	TArray<FString> Labels;
+	{
+		FScopeLock Lock(&ContextLock);
+		if (!bRankPooling)
+		{
+			UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Classify needs a model loaded with Rank pooling"));
+			return false;
+		}
+		Labels = ClassLabels;
+	}
+
+	TArray<TArray<float>> Scores;
+	if (!EmbedBlocking(Texts, Scores))
+	{
+		return false;
+	}
+
+	OutResults.SetNum(Scores.Num());
+	for (int32 t = 0; t < Scores.Num(); ++t)
+	{
+		const TArray<float>& Logits = Scores[t];
+		FLlamaClassification& Result = OutResults[t];
+		Result.Labels.SetNum(Logits.Num());
+
+		if (Logits.Num() == 1)
+		{
+			// Single-output heads are binary scorers
+			Result.Labels[0].Probability = 1.0f / (1.0f + FMath::Exp(-Logits[0]));
+		}
+		else
+		{
+			float MaxLogit = -MAX_flt;
+			for (float Logit : Logits)
+			{
+				MaxLogit = FMath::Max(MaxLogit, Logit);
+			}
+			double Sum = 0.0;
+			for (float Logit : Logits)
+			{
+				Sum += FMath::Exp(Logit - MaxLogit);
+			}
+			for (int32 i = 0; i < Logits.Num(); ++i)
+			{
+				Result.Labels[i].Probability = static_cast<float>(FMath::Exp(Logits[i] - MaxLogit) / Sum);
+			}
+		}
+
+		for (int32 i = 0; i < Logits.Num(); ++i)
+		{
+			Result.Labels[i].Label = Labels.IsValidIndex(i) ? Labels[i] : FString::Printf(TEXT("LABEL_%d"), i);
+			if (Result.BestIndex == INDEX_NONE || Result.Labels[i].Probability > Result.Labels[Result.BestIndex].Probability)
+			{
+				Result.BestIndex = i;
+			}
+		}
+	}
+	return true;
+}
+
+void ULlamaCppEmbedder::ClassifyAsync(const FString& Text)
+{
+	ClassifyBatchAsync({ Text });
+}
+
+void ULlamaCppEmbedder::ClassifyBatchAsync(const TArray<FString>& Texts)
+{
+	if (!IsModelLoaded())
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Cannot classify — no model loaded"));
+		OnTextsClassified.Broadcast(TArray<FLlamaClassification>());
+		return;
+	}
+
+	TWeakObjectPtr<ULlamaCppEmbedder> WeakThis(this);
+	RunPendingWork([this, WeakThis, TextsCopy = Texts]()
+	{
+		TArray<FLlamaClassification> Results;
+		ClassifyBlocking(TextsCopy, Results);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Results = MoveTemp(Results)]()
+		{
+			if (ULlamaCppEmbedder* Owner = WeakThis.Get())
+			{
+				Owner->OnTextsClassified.Broadcast(Results);
+			}
+		});
+	});
+}
+
+void ULlamaCppEmbedder::RunPendingWork(TUniqueFunction<void()> Work)
+{
+	++PendingEmbeds;
+	TAtomic<int32>* Pending = &PendingEmbeds;
+	FEvent* DoneEvent = EmbedDoneEvent;
+
+	Async(EAsyncExecution::Thread, [Work = MoveTemp(Work), Pending, DoneEvent]()
+	{
+		Work();
+
+		// Trigger first: once the count reaches zero BeginDestroy may return the event to the pool
+		DoneEvent->Trigger();
+		--*Pending;
+	});
+}
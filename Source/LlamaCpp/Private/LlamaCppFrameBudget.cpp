@@ -0,0 +1,36 @@
+#include "LlamaCppFrameBudget.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include <atomic>
+
+namespace
+{
+	std::atomic<float> FrameTimeMs{0.0f};
+	std::atomic<uint64> FrameCounter{0};
+}
+
+void FLlamaFrameBudget::Publish(float WorkSeconds)
+{
+	FrameTimeMs.store(WorkSeconds * 1000.0f, std::memory_order_relaxed);
+	FrameCounter.fetch_add(1, std::memory_order_release);
+}
+
+float FLlamaFrameBudget::GetFrameTimeMs()
+{
+	return FrameTimeMs.load(std::memory_order_relaxed);
+}
+
+uint64 FLlamaFrameBudget::GetFrameCounter()
+{
+	return FrameCounter.load(std::memory_order_acquire);
+}
+
+void FLlamaFrameBudget::WaitForNextFrame(float MaxWaitSeconds)
+{
+	const uint64 StartFrame = GetFrameCounter();
+	const double EndTime = FPlatformTime::Seconds() + MaxWaitSeconds;
+	while (GetFrameCounter() == StartFrame && FPlatformTime::Seconds() < EndTime)
+	{
+		FPlatformProcess::Sleep(0.001f);
+	}
+}
@@ -0,0 +1,95 @@
+#include "LlamaCppGenerationCache.h"
+#include "LlamaCppSamplerCache.h"
+#include "Hash/CityHash.h"
+
+bool FLlamaGenerationCache::IsDeterministic(const FLlamaSamplingParams& Params)
+{
+	// With a fixed seed the random stages are re-seeded identically on every request. Otherwise
+	// llama_sampler_init_temp with t <= 0 keeps only the most likely token, so the dist stage has no choice
+	// to make, but XTC runs before it and randomly removes the top candidates
+	return Params.Seed >= 0 || (Params.Temperature <= 0.0f && Params.XtcProbability <= 0.0f);
+}
+
+void FLlamaGenerationCache::SetModelIdentity(uint64 InModelIdentity)
+{
+	FScopeLock Lock(&CacheLock);
+	if (ModelIdentity != InModelIdentity)
+	{
+		ModelIdentity = InModelIdentity;
+		Entries.Empty();
+		SizeBytes = 0;
+	}
+}
+
+uint64 FLlamaGenerationCache::MakeKey(TArrayView<const llama_token> PromptTokens, int32 MaxTokens, const FLlamaSamplingParams& Params) const
+{
+	uint64 Hash = CityHash64WithSeed(reinterpret_cast<const char*>(PromptTokens.GetData()), PromptTokens.Num() * sizeof(llama_token), ModelIdentity);
+	Hash = CityHash64WithSeed(reinterpret_cast<const char*>(&MaxTokens), sizeof(MaxTokens), Hash);
+	return FLlamaSamplerCache::HashParams(Params, Hash);
+}
+
+bool FLlamaGenerationCache::Find(uint64 Key, TArrayView<const llama_token> PromptTokens, TArray<llama_token>& OutTokens)
+{
+	FScopeLock Lock(&CacheLock);
+
+	FEntry* Entry = Entries.Find(Key);
+	if (!Entry || Entry->PromptTokens.Num() != PromptTokens.Num()
+		|| FMemory::Memcmp(Entry->PromptTokens.GetData(), PromptTokens.GetData(), PromptTokens.Num() * sizeof(llama_token)) != 0)
+	{
+		return false;
+	}
+
+	Entry->LastUsed = ++UseCounter;
+	OutTokens = Entry->OutputTokens;
+	return true;
+}
+
+void FLlamaGenerationCache::Add(uint64 Key, TArrayView<const llama_token> PromptTokens, TArrayView<const llama_token> OutputTokens)
+{
+	FScopeLock Lock(&CacheLock);
+
+	if (FEntry* Existing = Entries.Find(Key))
+	{
+		SizeBytes -= Existing->GetSizeBytes();
+	}
+
+	FEntry& Entry = Entries.Add(Key);
+	Entry.PromptTokens = TArray<llama_token>(PromptTokens.GetData(), PromptTokens.Num());
+	Entry.OutputTokens = TArray<llama_token>(OutputTokens.GetData(), OutputTokens.Num());
+	Entry.LastUsed = ++UseCounter;
+	SizeBytes += Entry.GetSizeBytes();
+
+	EvictToFit();
+}
+
+void FLlamaGenerationCache::SetMaxBytes(int64 InMaxBytes)
+{
+	FScopeLock Lock(&CacheLock);
+	MaxBytes = InMaxBytes;
+	EvictToFit();
+}
+
+void FLlamaGenerationCache::Empty()
+{
+	FScopeLock Lock(&CacheLock);
+	Entries.Empty();
+	SizeBytes = 0;
+}
+
+void FLlamaGenerationCache::EvictToFit()
+{
+	while (Entries.Num() > 0 && SizeBytes > MaxBytes)
+	{
+		const TPair<uint64, FEntry>* Oldest = nullptr;
+		for (const TPair<uint64, FEntry>& Pair : Entries)
+		{
+			if (!Oldest || Pair.Value.LastUsed < Oldest->Value.LastUsed)
+			{
+				Oldest = &Pair;
+			}
+		}
+		const uint64 OldestKey = Oldest->Key;
+		SizeBytes -= Oldest->Value.GetSizeBytes();
+		Entries.Remove(OldestKey);
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LlamaCppInference.h"
+#include "llama.h"
+
+/**
+ * Exact-match cache of generated token streams. Deterministic requests (greedy sampling or a fixed
+ * seed) always produce the same output for the same prompt tokens, sampling params, token budget and model,
+ * so their output can be replayed instead of recomputed. Bounded by bytes, evicted LRU.
+ */
+class FLlamaGenerationCache
+{
+public:
+	/** True if the sampler chain built from Params has no randomness. */
+	static bool IsDeterministic(const FLlamaSamplingParams& Params);
+
+	/** Identify the loaded model; entries from a previous model are dropped. */
+	void SetModelIdentity(uint64 InModelIdentity);
+
+	uint64 MakeKey(TArrayView<const llama_token> PromptTokens, int32 MaxTokens, const FLlamaSamplingParams& Params) const;
+
+	bool Find(uint64 Key, TArrayView<const llama_token> PromptTokens, TArray<llama_token>& OutTokens);
+	void Add(uint64 Key, TArrayView<const llama_token> PromptTokens, TArrayView<const llama_token> OutputTokens);
+
+	void SetMaxBytes(int64 InMaxBytes);
+	void Empty();
+
+private:
+	struct FEntry
+	{
+		// Kept to rule out hash collisions
+		TArray<llama_token> PromptTokens;
+		TArray<llama_token> OutputTokens;
+		uint64 LastUsed = 0;
+
+		int64 GetSizeBytes() const
+		{
+			return sizeof(FEntry) + (PromptTokens.Num() + OutputTokens.Num()) * sizeof(llama_token);
+		}
+	};
+
+	TMap<uint64, FEntry> Entries;
+	uint64 ModelIdentity = 0;
+	int64 SizeBytes = 0;
+	int64 MaxBytes = 4 * 1024 * 1024;
+	uint64 UseCounter = 0;
+
+	FCriticalSection CacheLock;
+
+	void EvictToFit();
+};
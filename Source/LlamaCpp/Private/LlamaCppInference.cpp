@@ -1,21 +1,517 @@
 #include "LlamaCppInference.h"
+#include "LlamaCppEmbedder.h"
+#include "LlamaCppSemanticCache.h"
+#include "LlamaCppGenerationCache.h"
+#include "LlamaCppSamplerCache.h"
+#include "LlamaCppTokenizerCache.h"
+#include "LlamaConversation.h"
+#include "LlamaCppFrameBudget.h"
+#include "LlamaCppLogitFilter.h"
 #include "Async/Async.h"
+#include "HAL/PlatformTime.h"
+#include "Containers/StringConv.h"
+#include "Hash/CityHash.h"
 #include "llama.h"
 #include <string>
 #include "LlamaCppLog.h"
 
+namespace
+{
+	/** Tokenize UTF-8 text with the two-pass llama_tokenize pattern. Returns false if tokenization failed. */
+	bool TokenizeUtf8(const llama_vocab* Vocab, const std::string& Text, bool bAddSpecial, TArray<llama_token>& OutTokens)
+	{
+		OutTokens.Reset();
+		int32_t NTokens = -llama_tokenize(Vocab, Text.c_str(), Text.size(), nullptr, 0, bAddSpecial, true);
+		if (NTokens < 0)
+		{
+			return false;
+		}
+		OutTokens.SetNum(NTokens);
+		if (NTokens > 0)
+		{
+			llama_tokenize(Vocab, Text.c_str(), Text.size(), OutTokens.GetData(), OutTokens.Num(), bAddSpecial, true);
+		}
+		return true;
+	}
+
+	/** Decode Tokens into sequence SeqId starting at StartPos, split into n_batch sized chunks. Only the last token outputs logits. */
+	bool DecodeTokensChunked(llama_context* Ctx, TArrayView<const llama_token> Tokens, llama_pos StartPos, llama_seq_id SeqId)
+	{
+		const int32 BatchSize = static_cast<int32>(llama_n_batch(Ctx));
+		llama_batch Batch = llama_batch_init(BatchSize, 0, 1);
+		bool bOk = true;
+
+		for (int32 Start = 0; Start < Tokens.Num() && bOk; Start += BatchSize)
+		{
+			const int32 Count = FMath::Min(BatchSize, Tokens.Num() - Start);
+			Batch.n_tokens = Count;
+			for (int32 i = 0; i < Count; ++i)
+			{
+				Batch.token[i] = Tokens[Start + i];
+				Batch.pos[i] = StartPos + Start + i;
+				Batch.n_seq_id[i] = 1;
+				Batch.seq_id[i][0] = SeqId;
+				Batch.logits[i] = (Start + i == Tokens.Num() - 1);
+			}
+			bOk = llama_decode(Ctx, Batch) == 0;
+		}
+
+		llama_batch_free(Batch);
+		return bOk;
+	}
+
+	/** Append one token's UTF-8 piece to OutText. Returns false if the piece does not fit the buffer. */
+	bool AppendTokenPiece(const llama_vocab* Vocab, llama_token Token, std::string& OutText)
+	{
+		char Buf[256];
+		int32_t Len = llama_token_to_piece(Vocab, Token, Buf, sizeof(Buf), 0, true);
+		if (Len < 0)
+		{
+			return false;
+		}
+		OutText.append(Buf, Len);
+		return true;
+	}
+
+	/** Length of Text up to the end of its last complete UTF-8 code point, not looking before From. */
+	size_t CompleteUtf8Length(const std::string& Text, size_t From)
+	{
+		size_t Index = Text.size();
+		for (size_t Back = 1; Back <= 4 && Index > From; ++Back)
+		{
+			const uint8 Byte = static_cast<uint8>(Text[--Index]);
+			if ((Byte & 0xC0) != 0x80)
+			{
+				const size_t Needed = (Byte & 0xE0) == 0xC0 ? 2 : (Byte & 0xF0) == 0xE0 ? 3 : (Byte & 0xF8) == 0xF0 ? 4 : 1;
+				return Back >= Needed ? Text.size() : Index;
+			}
+		}
+		// Stray continuation bytes: pass them on rather than holding them forever
+		return Text.size();
+	}
+
+	FUtf8StringView MakeUtf8View(const std::string& Text, size_t Start, size_t End)
+	{
+		return FUtf8StringView(reinterpret_cast<const UTF8CHAR*>(Text.data()) + Start, static_cast<int32>(End - Start));
+	}
+
+	FString Utf8ToString(FUtf8StringView Text)
+	{
+		FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Text.GetData()), Text.Len());
+		return FString(Converted.Length(), Converted.Get());
+	}
+
+	using FOnTokensFunc = TFunctionRef<void(TArrayView<const llama_token> Tokens, FUtf8StringView Text, float Entropy)>;
+
+	/**
+	 * Collects generated tokens and their UTF-8 text and hands them to OnTokens. Text is only passed
+	 * on once it ends on a complete code point, so a piece split across tokens arrives in one call.
+	 */
+	class FTokenStream
+	{
+	public:
+		FTokenStream(const llama_vocab* InVocab, FOnTokensFunc InOnTokens, TArray<llama_token>& OutTokens, std::string& OutText)
+			: Vocab(InVocab), OnTokens(InOnTokens), Tokens(OutTokens), Text(OutText)
+		{
+			Tokens.Reset();
+			Text.clear();
+		}
+
+		bool Add(llama_token Token, float Entropy)
+		{
+			if (!AppendTokenPiece(Vocab, Token, Text))
+			{
+				return false;
+			}
+			Tokens.Add(Token);
+
+			const size_t Complete = CompleteUtf8Length(Text, EmittedBytes);
+			if (Complete > EmittedBytes)
+			{
+				Emit(Complete, Entropy);
+			}
+			return true;
+		}
+
+		/** Pass on whatever is still held back, e.g. when generation stops mid code point. */
+		void Flush()
+		{
+			if (EmittedTokens < Tokens.Num())
+			{
+				Emit(Text.size(), 0.0f);
+			}
+		}
+
+	private:
+		void Emit(size_t End, float Entropy)
+		{
+			OnTokens(TArrayView<const llama_token>(Tokens).Slice(EmittedTokens, Tokens.Num() - EmittedTokens),
+				MakeUtf8View(Text, EmittedBytes, End), Entropy);
+			EmittedTokens = Tokens.Num();
+			EmittedBytes = End;
+		}
+
+		const llama_vocab* Vocab;
+		FOnTokensFunc OnTokens;
+		TArray<llama_token>& Tokens;
+		std::string& Text;
+		int32 EmittedTokens = 0;
+		size_t EmittedBytes = 0;
+	};
+
+	/** Hash of the model file path, description and size, so cached outputs never cross models. */
+	uint64 ComputeModelIdentity(const llama_model* Model, const FString& ModelPath)
+	{
+		char Desc[256];
+		llama_model_desc(Model, Desc, sizeof(Desc));
+		const FString Identity = FString::Printf(TEXT("%s|%s|%llu|%llu"), *ModelPath, UTF8_TO_TCHAR(Desc),
+			static_cast<unsigned long long>(llama_model_n_params(Model)), static_cast<unsigned long long>(llama_model_size(Model)));
+		return CityHash64(reinterpret_cast<const char*>(*Identity), Identity.Len() * sizeof(TCHAR));
+	}
+
+	float LogSumExp(const float* Logits, int32 Num)
+	{
+		float MaxLogit = -MAX_flt;
+		for (int32 i = 0; i < Num; ++i)
+		{
+			MaxLogit = FMath::Max(MaxLogit, Logits[i]);
+		}
+		double Sum = 0.0;
+		for (int32 i = 0; i < Num; ++i)
+		{
+			Sum += FMath::Exp(Logits[i] - MaxLogit);
+		}
+		return MaxLogit + static_cast<float>(FMath::Loge(Sum));
+	}
+
+	/** Shannon entropy (nats) of softmax(Logits). High values mean the model is unsure of the next token. */
+	float TokenEntropy(const float* Logits, int32 Num)
+	{
+		float MaxLogit = -MAX_flt;
+		for (int32 i = 0; i < Num; ++i)
+		{
+			MaxLogit = FMath::Max(MaxLogit, Logits[i]);
+		}
+		// H = log Z - E[l - max] with Z = sum exp(l - max)
+		double Z = 0.0;
+		double Weighted = 0.0;
+		for (int32 i = 0; i < Num; ++i)
+		{
+			const double Shifted = Logits[i] - MaxLogit;
+			const double E = FMath::Exp(Shifted);
+			Z += E;
+			Weighted += E * Shifted;
+		}
+		return static_cast<float>(FMath::Loge(Z) - Weighted / Z);
+	}
+
+	/** Tokenize a full prompt, logging on failure. Empty prompts count as failures. */
+	bool TokenizePrompt(const llama_vocab* Vocab, const FString& Prompt, TArray<llama_token>& OutTokens)
+	{
+		if (!TokenizeUtf8(Vocab, TCHAR_TO_UTF8(*Prompt), true, OutTokens) || OutTokens.Num() == 0)
+		{
+			UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to tokenize prompt"));
+			return false;
+		}
+		return true;
+	}
+
+	/** Per-request settings for the token loop, beyond sampling. */
+	struct FGenerationOptions
+	{
+		bool bFrameBudget = false;
+		float FrameBudgetMs = 0.0f;
+		int32 MinThreads = 1;
+		int32 MaxThreads = 1;
+		// FPlatformTime::Seconds() at which the reply is cut off, 0 for none
+		double Deadline = 0.0;
+		// Called between tokens where another request may take over sequence 0 and restore it before returning
+		TFunction<void()> OnPreemptionPoint;
+		// Report the entropy of each token's predicted distribution to OnToken
+		bool bMeasureEntropy = false;
+	};
+
+	FGenerationOptions MakeOptions(const ULlamaCppInference& Inference, llama_context* Ctx)
+	{
+		FGenerationOptions GenOptions;
+		GenOptions.bFrameBudget = Inference.bFrameBudgetScheduling;
+		GenOptions.FrameBudgetMs = Inference.FrameBudgetMs;
+		GenOptions.MaxThreads = FMath::Max(1, static_cast<int32>(llama_n_threads(Ctx)));
+		GenOptions.MinThreads = FMath::Clamp(Inference.MinDecodeThreads, 1, GenOptions.MaxThreads);
+		GenOptions.bMeasureEntropy = Inference.bMeasureTokenEntropy;
+		if (Inference.RequestDeadlineSeconds > 0.0f)
+		{
+			GenOptions.Deadline = FPlatformTime::Seconds() + Inference.RequestDeadlineSeconds;
+		}
+		return GenOptions;
+	}
+
+	/**
+	 * Adapt decode threads to the last published frame time, at most once per frame. When already at
+	 * the minimum and the frame is still over budget, wait for the next frame before decoding again.
+	 */
+	void ApplyFrameBudget(llama_context* Ctx, const FGenerationOptions& GenOptions, int32& InOutThreads, uint64& InOutLastFrame)
+	{
+		const uint64 Frame = FLlamaFrameBudget::GetFrameCounter();
+		if (Frame == InOutLastFrame)
+		{
+			return;
+		}
+		InOutLastFrame = Frame;
+
+		const float FrameMs = FLlamaFrameBudget::GetFrameTimeMs();
+		const bool bOverBudget = FrameMs > GenOptions.FrameBudgetMs;
+		int32 Threads = InOutThreads;
+		if (bOverBudget)
+		{
+			Threads = FMath::Max(GenOptions.MinThreads, Threads - 1);
+		}
+		else if (FrameMs < GenOptions.FrameBudgetMs * 0.8f) // hysteresis so the count does not flip every frame
+		{
+			Threads = FMath::Min(GenOptions.MaxThreads, Threads + 1);
+		}
+
+		if (Threads != InOutThreads)
+		{
+			llama_set_n_threads(Ctx, Threads, llama_n_threads_batch(Ctx));
+			InOutThreads = Threads;
+		}
+
+		if (bOverBudget && Threads == GenOptions.MinThreads)
+		{
+			FLlamaFrameBudget::WaitForNextFrame(GenOptions.FrameBudgetMs / 1000.0f);
+		}
+	}
+
+	/**
+	 * Keep the longest prefix (at most MaxReuse tokens) that sequence 0 shares with Tokens and drop
+	 * the rest of the sequence. KvTokens mirrors sequence 0 and is trimmed to match. Returns the kept length.
+	 */
+	int32 RewindToSharedPrefix(llama_context* Ctx, TArrayView<const llama_token> Tokens, int32 MaxReuse, TArray<llama_token>& KvTokens)
+	{
+		MaxReuse = FMath::Min(KvTokens.Num(), MaxReuse);
+		int32 NumReused = 0;
+		while (NumReused < MaxReuse && KvTokens[NumReused] == Tokens[NumReused])
+		{
+			++NumReused;
+		}
+
+		llama_memory_t Mem = llama_get_memory(Ctx);
+		if (!llama_memory_seq_rm(Mem, 0, NumReused, -1))
+		{
+			// Memory types that cannot drop a partial range start over
+			llama_memory_clear(Mem, true);
+			NumReused = 0;
+		}
+		KvTokens.SetNum(NumReused);
+		return NumReused;
+	}
+
+	/**
+	 * Bring sequence 0 up to Tokens without sampling: the shared prefix is kept, a revised tail is
+	 * rolled back, and the rest is decoded ChunkSize tokens at a time. ShouldStop is checked between
+	 * chunks; what was decoded so far stays valid. Returns false if a decode failed.
+	 */
+	bool PrefillTokens(llama_context* Ctx, TArrayView<const llama_token> Tokens, int32 ChunkSize, TArray<llama_token>& KvTokens,
+		TFunctionRef<bool()> ShouldStop)
+	{
+		ChunkSize = FMath::Max(1, ChunkSize);
+		const int32 NumReused = RewindToSharedPrefix(Ctx, Tokens, Tokens.Num(), KvTokens);
+
+		for (int32 Start = NumReused; Start < Tokens.Num(); Start += ChunkSize)
+		{
+			if (ShouldStop())
+			{
+				break;
+			}
+			const int32 Count = FMath::Min(ChunkSize, Tokens.Num() - Start);
+			if (!DecodeTokensChunked(Ctx, Tokens.Slice(Start, Count), Start, 0))
+			{
+				UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Speculative prefill failed to decode"));
+				llama_memory_clear(llama_get_memory(Ctx), true);
+				KvTokens.Reset();
+				return false;
+			}
+			KvTokens.Append(Tokens.GetData() + Start, Count);
+		}
+
+		UE_LOG(LogLlamaCpp, Verbose, TEXT("LlamaCpp: Speculative prefill holds %d tokens (%d reused)"), KvTokens.Num(), NumReused);
+		return true;
+	}
+
+	/**
+	 * Evaluate PromptTokens on sequence 0 and sample up to MaxTokens on the calling thread.
+	 * New tokens and their UTF-8 text are passed to OnTokens (with the last token's entropy if requested,
+	 * else 0) and collected in OutTokens and OutText. Returns true if the reply ran to completion (end of
+	 * generation or MaxTokens), false if the prompt could not be decoded or the reply was cut short by
+	 * cancellation, the deadline or an error.
+	 *
+	 * KvTokens mirrors what sequence 0 currently holds. The longest prefix shared with PromptTokens
+	 * stays in the KV cache and only the remainder is decoded; KvTokens is updated to match.
+	 *
+	 * If ExactCache is set and the request is deterministic, a cached token stream for the same
+	 * prompt and params is replayed through OnToken without touching the model.
+	 */
+	bool RunGeneration(llama_context* Ctx, const llama_vocab* Vocab, TArrayView<const llama_token> PromptTokens, int32 MaxTokens,
+		const FLlamaSamplingParams& SamplingParams, const FGenerationOptions& GenOptions, const TAtomic<bool>& CancelFlag,
+		FLlamaGenerationCache* ExactCache, FLlamaSamplerCache& Samplers, TArray<llama_token>& KvTokens, FOnTokensFunc OnTokens,
+		TArray<llama_token>& OutTokens, std::string& OutText)
+	{
+		FTokenStream Stream(Vocab, OnTokens, OutTokens, OutText);
+
+		// --- Exact-match cache ---
+		const bool bCacheable = ExactCache && FLlamaGenerationCache::IsDeterministic(SamplingParams);
+		const uint64 CacheKey = bCacheable ? ExactCache->MakeKey(PromptTokens, MaxTokens, SamplingParams) : 0;
+		TArray<llama_token> CachedTokens;
+
+		if (bCacheable && ExactCache->Find(CacheKey, PromptTokens, CachedTokens))
+		{
+			bool bReplayed = true;
+			for (llama_token Token : CachedTokens)
+			{
+				if (CancelFlag || !Stream.Add(Token, 0.0f))
+				{
+					bReplayed = false;
+					break;
+				}
+			}
+			Stream.Flush();
+			return bReplayed;
+		}
+
+		// --- Reuse the KV prefix shared with the previous request ---
+		// At least one prompt token is always decoded so there are fresh logits to sample from
+		llama_memory_t Mem = llama_get_memory(Ctx);
+		const int32 NumReused = RewindToSharedPrefix(Ctx, PromptTokens, PromptTokens.Num() - 1, KvTokens);
+
+		// --- Sampler chain, reused and reset rather than rebuilt ---
+		llama_sampler* Sampler = Samplers.Acquire(llama_get_model(Ctx), SamplingParams);
+
+		// --- Prompt eval ---
+		if (!DecodeTokensChunked(Ctx, PromptTokens.Slice(NumReused, PromptTokens.Num() - NumReused), NumReused, 0))
+		{
+			UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to decode prompt"));
+			llama_memory_clear(Mem, true);
+			KvTokens.Reset();
+			Samplers.Release(Sampler);
+			return false;
+		}
+		KvTokens.Append(PromptTokens.GetData() + NumReused, PromptTokens.Num() - NumReused);
+
+		// --- Token generation loop ---
+		bool bFinishedCleanly = true;
+		const int32 NVocab = llama_vocab_n_tokens(Vocab);
+		int32 Threads = GenOptions.MaxThreads;
+		uint64 LastFrame = 0;
+		for (int32 i = 0; i < MaxTokens; ++i)
+		{
+			if (CancelFlag)
+			{
+				bFinishedCleanly = false;
+				break;
+			}
+
+			if (GenOptions.Deadline > 0.0 && FPlatformTime::Seconds() >= GenOptions.Deadline)
+			{
+				UE_LOG(LogLlamaCpp, Log, TEXT("LlamaCpp: Request deadline reached after %d tokens"), i);
+				bFinishedCleanly = false;
+				break;
+			}
+
+			if (GenOptions.bFrameBudget)
+			{
+				ApplyFrameBudget(Ctx, GenOptions, Threads, LastFrame);
+			}
+
+			// Measured on the raw logits, before the sampler chain modifies them
+			const float Entropy = GenOptions.bMeasureEntropy ? TokenEntropy(llama_get_logits_ith(Ctx, -1), NVocab) : 0.0f;
+
+			llama_token NewToken = llama_sampler_sample(Sampler, Ctx, -1);
+
+			if (llama_vocab_is_eog(Vocab, NewToken))
+			{
+				break;
+			}
+
+			if (!Stream.Add(NewToken, Entropy))
+			{
+				bFinishedCleanly = false;
+				break;
+			}
+
+			// Preemption point: sequence 0 matches KvTokens and no logits are needed until NewToken is decoded
+			if (GenOptions.OnPreemptionPoint)
+			{
+				GenOptions.OnPreemptionPoint();
+				if (CancelFlag)
+				{
+					bFinishedCleanly = false;
+					break;
+				}
+				if (static_cast<int32>(llama_n_threads(Ctx)) != Threads)
+				{
+					llama_set_n_threads(Ctx, Threads, llama_n_threads_batch(Ctx));
+				}
+			}
+
+			// Prepare next batch
+			llama_batch Batch = llama_batch_get_one(&NewToken, 1);
+			if (llama_decode(Ctx, Batch) != 0)
+			{
+				UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Decode failed at token %d"), i);
+				llama_memory_clear(Mem, true);
+				KvTokens.Reset();
+				bFinishedCleanly = false;
+				break;
+			}
+			KvTokens.Add(NewToken);
+		}
+
+		Stream.Flush();
+
+		// Cancelled or failed streams are truncated and must not be replayed
+		if (bCacheable && bFinishedCleanly)
+		{
+			ExactCache->Add(CacheKey, PromptTokens, OutTokens);
+		}
+
+		if (Threads != GenOptions.MaxThreads)
+		{
+			llama_set_n_threads(Ctx, GenOptions.MaxThreads, llama_n_threads_batch(Ctx));
+		}
+
+		Samplers.Release(Sampler);
+		return bFinishedCleanly;
+	}
+}
+
+struct ULlamaCppInference::FQueuedRequest
+{
+	int32 RequestId = INDEX_NONE;
+	ELlamaRequestPriority Priority = ELlamaRequestPriority::Normal;
+	FString Prompt;
+	int32 MaxTokens = 256;
+	FLlamaSamplingParams SamplingParams;
+	double Deadline = 0.0;
+	TAtomic<bool> bCancelled{false};
+};
+
 ULlamaCppInference::ULlamaCppInference()
 {
 	GenerationDoneEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	ExactCache = MakeShared<FLlamaGenerationCache, ESPMode::ThreadSafe>();
+	SamplerCache = MakeShared<FLlamaSamplerCache, ESPMode::ThreadSafe>();
+	TokenizerCache = MakeShared<FLlamaTokenizerCache, ESPMode::ThreadSafe>();
 }
 
 void ULlamaCppInference::BeginDestroy()
 {
 	StopGeneration();
 
-	if (bIsGenerating)
+	// Polled: prefill workers trigger the same event
+	while (bIsGenerating || NumPrefillWorkers > 0)
 	{
-		GenerationDoneEvent->Wait();
+		GenerationDoneEvent->Wait(10);
 	}
 
 	UnloadModel();
@@ -39,8 +535,9 @@ void ULlamaCppInference::LoadModel(const FString& ModelPath, int32 ContextSize)
 	// Capture a weak reference for the async callback
 	TWeakObjectPtr<ULlamaCppInference> WeakThis(this);
 	FString PathCopy = ModelPath;
+	int32 NumSequences = FMath::Clamp(MaxParallelSequences, 2, static_cast<int32>(llama_max_parallel_sequences()));
 
-	Async(EAsyncExecution::Thread, [WeakThis, PathCopy, ContextSize]()
+	Async(EAsyncExecution::Thread, [WeakThis, PathCopy, ContextSize, NumSequences]()
 	{
 		llama_model_params ModelParams = llama_model_default_params();
 		ModelParams.n_gpu_layers = 0; // CPU-only on Quest 3
@@ -59,6 +556,8 @@ void ULlamaCppInference::LoadModel(const FString& ModelPath, int32 ContextSize)
 			llama_context_params CtxParams = llama_context_default_params();
 			CtxParams.n_ctx = ContextSize;
 			CtxParams.n_batch = 512;
+			CtxParams.n_seq_max = NumSequences;
+			CtxParams.kv_unified = true; // option sequences share the prompt prefix
 			CtxParams.no_perf = true;
 
 			LoadedCtx = llama_init_from_model(LoadedModel, CtxParams);
@@ -76,7 +575,7 @@ void ULlamaCppInference::LoadModel(const FString& ModelPath, int32 ContextSize)
 			UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to load model from %s"), *PathCopy);
 		}
 
-		AsyncTask(ENamedThreads::GameThread, [WeakThis, LoadedModel, LoadedCtx, LoadedVocab, bSuccess]()
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, PathCopy, LoadedModel, LoadedCtx, LoadedVocab, bSuccess]()
 		{
 			if (ULlamaCppInference* Self = WeakThis.Get())
 			{
@@ -85,6 +584,8 @@ void ULlamaCppInference::LoadModel(const FString& ModelPath, int32 ContextSize)
 					Self->Model = LoadedModel;
 					Self->Ctx = LoadedCtx;
 					Self->Vocab = LoadedVocab;
+					Self->KvTokens.Reset();
+					Self->ExactCache->SetModelIdentity(ComputeModelIdentity(LoadedModel, PathCopy));
 					UE_LOG(LogLlamaCpp, Log, TEXT("LlamaCpp: Model loaded successfully"));
 				}
 				Self->OnModelLoaded.Broadcast(bSuccess);
@@ -101,6 +602,13 @@ void ULlamaCppInference::LoadModel(const FString& ModelPath, int32 ContextSize)
 
 void ULlamaCppInference::UnloadModel()
 {
+	// Supersede any speculative prefill and let it leave the context
+	++PrefillSerial;
+	while (NumPrefillWorkers > 0)
+	{
+		GenerationDoneEvent->Wait(10);
+	}
+
 	if (Ctx)
 	{
 		llama_free(Ctx);
@@ -112,161 +620,957 @@ void ULlamaCppInference::UnloadModel()
 		Model = nullptr;
 	}
 	Vocab = nullptr;
+	KvTokens.Reset();
+	ExactCache->Empty();
+	SamplerCache->Empty();
+	TokenizerCache->Empty();
 }
 
-bool ULlamaCppInference::IsModelLoaded() const
+int32 ULlamaCppInference::CountTokens(const FString& Text, bool bAddSpecial)
 {
-	return Model != nullptr && Ctx != nullptr;
+	TArray<llama_token> Tokens;
+	return Tokenize(Text, Tokens, bAddSpecial) ? Tokens.Num() : -1;
 }
 
-void ULlamaCppInference::GenerateTextAsync(const FString& Prompt, int32 MaxTokens, FLlamaSamplingParams SamplingParams)
+bool ULlamaCppInference::Tokenize(const FString& Text, TArray<int32>& OutTokens, bool bAddSpecial)
 {
-	if (!IsModelLoaded())
+	OutTokens.Reset();
+	if (!Vocab)
 	{
-		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Cannot generate — no model loaded"));
-		OnGenerationComplete.Broadcast(TEXT(""));
-		return;
+		return false;
 	}
+	TokenizerCache->SetMaxBytes(TokenizerCacheMaxBytes);
+	return TokenizerCache->Tokenize(Vocab, Text, bAddSpecial, OutTokens);
+}
 
-	if (bIsGenerating)
+FString ULlamaCppInference::BuildPromptWithinBudget(const TArray<FLlamaPromptFragment>& Fragments, int32 MaxTokens, int32& OutNumTokens)
+{
+	OutNumTokens = 0;
+	if (!Vocab)
 	{
-		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Generation already in progress"));
-		return;
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Cannot budget prompt — no model loaded"));
+		return FString();
 	}
 
-	bCancelGeneration = false;
-	bIsGenerating = true;
-
-	TWeakObjectPtr<ULlamaCppInference> WeakThis(this);
-	FString PromptCopy = Prompt;
-
-	// Capture raw pointers for the background thread (they remain valid
-	// as long as the UObject is alive, and we check via WeakThis)
-	llama_context* BgCtx = Ctx;
-	const llama_vocab* BgVocab = Vocab;
-	TAtomic<bool>* CancelFlag = &bCancelGeneration;
-	TAtomic<bool>* GeneratingFlag = &bIsGenerating;
-	FEvent* DoneEvent = GenerationDoneEvent;
+	const int32 Budget = CachedContextSize - MaxTokens;
+	// BOS and other special tokens added around the whole prompt
+	const int32 SpecialTokens = FMath::Max(0, CountTokens(FString(), true));
 
-	Async(EAsyncExecution::Thread, [WeakThis, PromptCopy, MaxTokens, SamplingParams,
-							BgCtx, BgVocab, CancelFlag, GeneratingFlag, DoneEvent]()
+	// Highest priority first; within a priority the latest fragment first
+	TArray<int32> Order;
+	Order.Reserve(Fragments.Num());
+	for (int32 i = 0; i < Fragments.Num(); ++i)
 	{
-		FString FullResult;
-
-		// --- Clear KV cache ---
-		llama_memory_clear(llama_get_memory(BgCtx), true);
+		Order.Add(i);
+	}
+	Order.Sort([&Fragments](int32 A, int32 B)
+	{
+		return Fragments[A].Priority != Fragments[B].Priority ? Fragments[A].Priority > Fragments[B].Priority : A > B;
+	});
 
-		// --- Tokenize ---
-		std::string PromptUtf8 = TCHAR_TO_UTF8(*PromptCopy);
-		int32_t NPromptTokens = -llama_tokenize(BgVocab, PromptUtf8.c_str(),
-			PromptUtf8.size(), nullptr, 0, true, true);
+	// Pack by per-fragment counts, skipping any fragment that does not fit
+	TArray<bool> Included;
+	Included.SetNumZeroed(Fragments.Num());
+	TArray<int32> IncludedOrder;
+	int32 Used = SpecialTokens;
+	for (int32 Index : Order)
+	{
+		const int32 Count = CountTokens(Fragments[Index].Text);
+		if (Count >= 0 && Used + Count <= Budget)
+		{
+			Used += Count;
+			Included[Index] = true;
+			IncludedOrder.Add(Index);
+		}
+	}
 
-		if (NPromptTokens <= 0)
+	// Tokens can merge across fragment boundaries, so verify the assembled prompt and trim if needed
+	TArray<llama_token> Tokens;
+	for (;;)
+	{
+		FString Prompt;
+		for (int32 i = 0; i < Fragments.Num(); ++i)
 		{
-			UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to tokenize prompt"));
-			*GeneratingFlag = false;
-			DoneEvent->Trigger();
-			AsyncTask(ENamedThreads::GameThread, [WeakThis]()
+			if (Included[i])
 			{
-				if (auto* Self = WeakThis.Get())
-					Self->OnGenerationComplete.Broadcast(TEXT(""));
-			});
-			return;
+				Prompt += Fragments[i].Text;
+			}
 		}
 
-		TArray<int32_t> PromptTokens;
-		PromptTokens.SetNum(NPromptTokens);
-		llama_tokenize(BgVocab, PromptUtf8.c_str(), PromptUtf8.size(),
-			PromptTokens.GetData(), PromptTokens.Num(), true, true);
-
-		// --- Build sampler chain ---
-		auto SChainParams = llama_sampler_chain_default_params();
-		SChainParams.no_perf = true;
-		llama_sampler* Sampler = llama_sampler_chain_init(SChainParams);
-
-		llama_sampler_chain_add(Sampler, llama_sampler_init_penalties(
-			64,                            // penalty_last_n
-			SamplingParams.RepeatPenalty,   // penalty_repeat
-			0.0f,                          // penalty_freq
-			0.0f));                        // penalty_present
-		llama_sampler_chain_add(Sampler, llama_sampler_init_top_k(SamplingParams.TopK));
-		llama_sampler_chain_add(Sampler, llama_sampler_init_top_p(SamplingParams.TopP, 1));
-		llama_sampler_chain_add(Sampler, llama_sampler_init_min_p(SamplingParams.MinP, 1));
-		llama_sampler_chain_add(Sampler, llama_sampler_init_temp(SamplingParams.Temperature));
-		llama_sampler_chain_add(Sampler, llama_sampler_init_dist(LLAMA_DEFAULT_SEED));
-
-		// --- Prompt eval ---
-		llama_batch Batch = llama_batch_get_one(PromptTokens.GetData(), PromptTokens.Num());
-		if (llama_decode(BgCtx, Batch) != 0)
+		if (!TokenizeUtf8(Vocab, TCHAR_TO_UTF8(*Prompt), true, Tokens))
 		{
-			UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to decode prompt"));
-			llama_sampler_free(Sampler);
-			*GeneratingFlag = false;
-			DoneEvent->Trigger();
-			AsyncTask(ENamedThreads::GameThread, [WeakThis]()
-			{
-				if (auto* Self = WeakThis.Get())
-					Self->OnGenerationComplete.Broadcast(TEXT(""));
-			});
-			return;
+			UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to tokenize budgeted prompt"));
+			return FString();
 		}
-
-		// --- Token generation loop ---
-		for (int32 i = 0; i < MaxTokens; ++i)
+		if (Tokens.Num() <= Budget || IncludedOrder.Num() == 0)
 		{
-			if (*CancelFlag)
-			{
-				break;
-			}
-
-			llama_token NewToken = llama_sampler_sample(Sampler, BgCtx, -1);
-
-			if (llama_vocab_is_eog(BgVocab, NewToken))
+			OutNumTokens = Tokens.Num();
+			if (Tokens.Num() > Budget)
 			{
-				break;
+				UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: No fragment fits a budget of %d tokens"), Budget);
 			}
+			return Prompt;
+		}
+		Included[IncludedOrder.Pop()] = false;
+	}
+}
 
-			// Convert token to text
-			char Buf[256];
-			int32_t Len = llama_token_to_piece(BgVocab, NewToken, Buf, sizeof(Buf), 0, true);
-			if (Len < 0)
-			{
-				break;
-			}
+bool ULlamaCppInference::IsModelLoaded() const
+{
+	return Model != nullptr && Ctx != nullptr;
+}
 
-			FString TokenStr = UTF8_TO_TCHAR(std::string(Buf, Len).c_str());
-			FullResult += TokenStr;
+TSharedPtr<FLlamaGenerationRequest, ESPMode::ThreadSafe> ULlamaCppInference::StartGeneration(const FString& Prompt, int32 MaxTokens,
+	const FLlamaSamplingParams& SamplingParams, FLlamaStreamCallbacks Callbacks)
+{
+	return StartGenerationInternal(Prompt, TArray<llama_token>(), MaxTokens, ResolveSamplingParams(SamplingParams), MoveTemp(Callbacks));
+}
 
-			// Stream token to game thread
-			AsyncTask(ENamedThreads::GameThread, [WeakThis, TokenStr]()
-			{
-				if (auto* Self = WeakThis.Get())
-					Self->OnTokenGenerated.Broadcast(TokenStr);
-			});
+TSharedPtr<FLlamaGenerationRequest, ESPMode::ThreadSafe> ULlamaCppInference::StartGeneration(TArray<int32> PromptTokens, int32 MaxTokens,
+	const FLlamaSamplingParams& SamplingParams, FLlamaStreamCallbacks Callbacks)
+{
+	if (PromptTokens.Num() == 0)
+	{
+		return nullptr;
+	}
+	return StartGenerationInternal(FString(), MoveTemp(PromptTokens), MaxTokens, ResolveSamplingParams(SamplingParams), MoveTemp(Callbacks));
+}
 
-			// Prepare next batch
-			Batch = llama_batch_get_one(&NewToken, 1);
-			if (llama_decode(BgCtx, Batch) != 0)
+FLlamaSamplingParams ULlamaCppInference::ResolveSamplingParams(const FLlamaSamplingParams& SamplingParams) const
+{
+	FLlamaSamplingParams Resolved = SamplingParams;
+	Resolved.CompiledLogitFilter = SamplingParams.LogitFilter ? SamplingParams.LogitFilter->Compile(Model) : nullptr;
+	return Resolved;
+}
+
+TSharedPtr<FLlamaGenerationRequest, ESPMode::ThreadSafe> ULlamaCppInference::StartGenerationInternal(const FString& Prompt,
+	TArray<int32>&& PromptTokens, int32 MaxTokens, const FLlamaSamplingParams& SamplingParams, FLlamaStreamCallbacks&& Callbacks)
+{
+	if (!IsModelLoaded() || bIsGenerating)
+	{
+		return nullptr;
+	}
+
+	bIsGenerating = true;
+	ResetTokenEntropy();
+
+	TSharedRef<FLlamaGenerationRequest, ESPMode::ThreadSafe> Request = MakeShared<FLlamaGenerationRequest, ESPMode::ThreadSafe>();
+	ActiveStream = Request;
+
+	// Capture raw pointers for the background thread; BeginDestroy waits for bIsGenerating
+	llama_context* BgCtx = Ctx;
+	const llama_vocab* BgVocab = Vocab;
+	FLlamaGenerationCache* BgExactCache = GetExactCache();
+	FLlamaSamplerCache* BgSamplers = SamplerCache.Get();
+	TArray<llama_token>* BgKvTokens = &KvTokens;
+	FCriticalSection* BgContextLock = &ContextLock;
+	FGenerationOptions GenOptions = MakeOptions(*this, Ctx);
+	TAtomic<bool>* GeneratingFlag = &bIsGenerating;
+	FEvent* DoneEvent = GenerationDoneEvent;
+	TWeakObjectPtr<ULlamaCppInference> WeakThis(this);
+
+	Async(EAsyncExecution::Thread, [WeakThis, Request, Prompt, PromptTokens = MoveTemp(PromptTokens), MaxTokens, SamplingParams, Callbacks = MoveTemp(Callbacks),
+							BgContextLock, BgCtx, BgVocab, BgExactCache, BgSamplers, BgKvTokens, GenOptions, GeneratingFlag, DoneEvent]() mutable
+	{
+		TArray<llama_token> OutTokens;
+		std::string OutText;
+		bool bCompleted = false;
+		{
+			FScopeLock ContextScope(BgContextLock);
+			if (PromptTokens.Num() > 0 || TokenizePrompt(BgVocab, Prompt, PromptTokens))
 			{
-				UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Decode failed at token %d"), i);
-				break;
+				bCompleted = RunGeneration(BgCtx, BgVocab, PromptTokens, MaxTokens, SamplingParams, GenOptions, Request->bCancelled,
+					BgExactCache, *BgSamplers, *BgKvTokens,
+					[&Callbacks](TArrayView<const llama_token> Tokens, FUtf8StringView Text, float Entropy)
+					{
+						if (Callbacks.OnTokens)
+						{
+							Callbacks.OnTokens(Tokens, Text, Entropy);
+						}
+					},
+					OutTokens, OutText);
 			}
 		}
 
-		llama_sampler_free(Sampler);
-		*GeneratingFlag = false;
+		Request->bDone = true;
+		// Trigger before clearing the flag; once it drops BeginDestroy may return the event to the pool
 		DoneEvent->Trigger();
+		*GeneratingFlag = false;
 
-		// Broadcast final result
-		AsyncTask(ENamedThreads::GameThread, [WeakThis, FullResult]()
+		if (Callbacks.OnComplete)
+		{
+			Callbacks.OnComplete(OutTokens, MakeUtf8View(OutText, 0, OutText.size()), bCompleted);
+		}
+
+		// Start whatever EnqueueGeneration queued meanwhile, whichever API started this run. Queued after
+		// OnComplete, so game-thread completion handlers still run first
+		AsyncTask(ENamedThreads::GameThread, [WeakThis]()
+		{
+			if (ULlamaCppInference* Self = WeakThis.Get())
+			{
+				Self->PumpRequestQueue();
+			}
+		});
+	});
+
+	return Request;
+}
+
+FLlamaStreamCallbacks ULlamaCppInference::MakeEventCallbacks(TFunction<void(const FString&)> OnGameThreadComplete)
+{
+	// Adapter from the native stream to the Blueprint events, which fire on the game thread
+	TWeakObjectPtr<ULlamaCppInference> WeakThis(this);
+	FLlamaStreamCallbacks Callbacks;
+	Callbacks.OnTokens = [WeakThis](TArrayView<const int32>, FUtf8StringView Text, float Entropy)
+	{
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, TokenStr = Utf8ToString(Text), Entropy]()
 		{
 			if (auto* Self = WeakThis.Get())
+			{
+				Self->RecordTokenEntropy(Entropy);
+				Self->OnTokenGenerated.Broadcast(TokenStr);
+			}
+		});
+	};
+	Callbacks.OnComplete = [WeakThis, OnGameThreadComplete = MoveTemp(OnGameThreadComplete)](TArrayView<const int32>, FUtf8StringView Text, bool)
+	{
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, OnGameThreadComplete, FullResult = Utf8ToString(Text)]()
+		{
+			if (OnGameThreadComplete)
+			{
+				OnGameThreadComplete(FullResult);
+			}
+			if (auto* Self = WeakThis.Get())
+			{
 				Self->OnGenerationComplete.Broadcast(FullResult);
+			}
+		});
+	};
+	return Callbacks;
+}
+
+void ULlamaCppInference::GenerateTextAsync(const FString& Prompt, int32 MaxTokens, FLlamaSamplingParams SamplingParams)
+{
+	if (!IsModelLoaded())
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Cannot generate — no model loaded"));
+		OnGenerationComplete.Broadcast(TEXT(""));
+		return;
+	}
+
+	if (bIsGenerating)
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Generation already in progress"));
+		return;
+	}
+
+	StartGeneration(Prompt, MaxTokens, SamplingParams, MakeEventCallbacks(nullptr));
+}
+
+void ULlamaCppInference::GenerateTextCachedAsync(const FString& Prompt, const FString& UserTurn, const FString& CacheScope,
+	int32 MaxTokens, FLlamaSamplingParams SamplingParams)
+{
+	if (!SemanticCache || !SemanticCache->Embedder || !SemanticCache->Embedder->IsModelLoaded())
+	{
+		UE_LOG(LogLlamaCpp, Verbose, TEXT("LlamaCpp: No semantic cache with a loaded embedder, generating uncached"));
+		GenerateTextAsync(Prompt, MaxTokens, SamplingParams);
+		return;
+	}
+
+	if (!IsModelLoaded())
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Cannot generate — no model loaded"));
+		OnGenerationComplete.Broadcast(TEXT(""));
+		return;
+	}
+
+	if (bIsGenerating)
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Generation already in progress"));
+		return;
+	}
+
+	bIsGenerating = true;
+	ResetTokenEntropy();
+
+	TSharedRef<FLlamaGenerationRequest, ESPMode::ThreadSafe> Request = MakeShared<FLlamaGenerationRequest, ESPMode::ThreadSafe>();
+	ActiveStream = Request;
+
+	FString PromptCopy = Prompt;
+	FString UserTurnCopy = UserTurn;
+	FString ScopeCopy = CacheScope;
+	FLlamaSamplingParams ResolvedParams = ResolveSamplingParams(SamplingParams);
+	FLlamaStreamCallbacks Callbacks = MakeEventCallbacks(nullptr);
+
+	// The cache and its embedder are referenced by this object, and BeginDestroy waits
+	// for the worker, so the raw pointers stay valid like the llama ones below
+	ULlamaCppSemanticCache* BgCache = SemanticCache;
+	ULlamaCppEmbedder* BgEmbedder = SemanticCache->Embedder;
+	llama_context* BgCtx = Ctx;
+	const llama_vocab* BgVocab = Vocab;
+	FLlamaGenerationCache* BgExactCache = GetExactCache();
+	FLlamaSamplerCache* BgSamplers = SamplerCache.Get();
+	TArray<llama_token>* BgKvTokens = &KvTokens;
+	FCriticalSection* BgContextLock = &ContextLock;
+	FGenerationOptions GenOptions = MakeOptions(*this, Ctx);
+	TAtomic<bool>* GeneratingFlag = &bIsGenerating;
+	FEvent* DoneEvent = GenerationDoneEvent;
+	TWeakObjectPtr<ULlamaCppInference> WeakThis(this);
+
+	Async(EAsyncExecution::Thread, [WeakThis, Request, PromptCopy, UserTurnCopy, ScopeCopy, MaxTokens, SamplingParams = MoveTemp(ResolvedParams), Callbacks, BgContextLock,
+							BgCache, BgEmbedder, BgCtx, BgVocab, BgExactCache, BgSamplers, BgKvTokens, GenOptions, GeneratingFlag, DoneEvent]()
+	{
+		TArray<llama_token> OutTokens;
+		std::string OutText;
+		bool bCompleted = false;
+
+		TArray<TArray<float>> Vectors;
+		const bool bEmbedded = BgEmbedder->EmbedBlocking({ UserTurnCopy }, Vectors) && Vectors.Num() == 1;
+
+		FString CachedResponse;
+		if (bEmbedded && BgCache->Lookup(ScopeCopy, Vectors[0], CachedResponse))
+		{
+			UE_LOG(LogLlamaCpp, Verbose, TEXT("LlamaCpp: Semantic cache hit in scope '%s'"), *ScopeCopy);
+
+			// Deliver the whole response as a single chunk so listeners see the usual event order
+			OutText = TCHAR_TO_UTF8(*CachedResponse);
+			Callbacks.OnTokens(OutTokens, MakeUtf8View(OutText, 0, OutText.size()), 0.0f);
+			bCompleted = true;
+		}
+		else
+		{
+			FScopeLock ContextScope(BgContextLock);
+			TArray<llama_token> PromptTokens;
+			bCompleted = TokenizePrompt(BgVocab, PromptCopy, PromptTokens)
+				&& RunGeneration(BgCtx, BgVocab, PromptTokens, MaxTokens, SamplingParams, GenOptions, Request->bCancelled, BgExactCache, *BgSamplers,
+					*BgKvTokens, Callbacks.OnTokens, OutTokens, OutText);
+
+			// Truncated responses (cancelled, deadline) must not be replayed later
+			if (bEmbedded && bCompleted && !OutText.empty())
+			{
+				BgCache->Insert(ScopeCopy, Vectors[0], UTF8_TO_TCHAR(OutText.c_str()));
+			}
+		}
+
+		Request->bDone = true;
+		DoneEvent->Trigger();
+		*GeneratingFlag = false;
+
+		Callbacks.OnComplete(OutTokens, MakeUtf8View(OutText, 0, OutText.size()), bCompleted);
+
+		// Same as StartGenerationInternal: start anything EnqueueGeneration queued while this ran
+		AsyncTask(ENamedThreads::GameThread, [WeakThis]()
+		{
+			if (ULlamaCppInference* Self = WeakThis.Get())
+			{
+				Self->PumpRequestQueue();
+			}
 		});
 	});
 }
 
+void ULlamaCppInference::GenerateConversationAsync(ULlamaConversation* Conversation, int32 MaxTokens,
+	FLlamaSamplingParams SamplingParams, bool bAppendReply)
+{
+	if (!IsModelLoaded())
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Cannot generate — no model loaded"));
+		OnGenerationComplete.Broadcast(TEXT(""));
+		return;
+	}
+
+	if (bIsGenerating)
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Generation already in progress"));
+		return;
+	}
+
+	TArray<llama_token> PromptTokens;
+	if (!Conversation || !Conversation->BuildPromptTokens(Model, PromptTokens))
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to build conversation prompt"));
+		OnGenerationComplete.Broadcast(TEXT(""));
+		return;
+	}
+
+	// The reply is appended before OnGenerationComplete fires
+	TWeakObjectPtr<ULlamaConversation> WeakConversation(Conversation);
+	StartGeneration(MoveTemp(PromptTokens), MaxTokens, SamplingParams, MakeEventCallbacks(
+		[WeakConversation, bAppendReply](const FString& FullResult)
+		{
+			ULlamaConversation* Conv = WeakConversation.Get();
+			if (bAppendReply && Conv && !FullResult.IsEmpty())
+			{
+				Conv->AddMessage(TEXT("assistant"), FullResult);
+			}
+		}));
+}
+
+void ULlamaCppInference::PrefillPartialAsync(const FString& PartialPrompt)
+{
+	if (!IsModelLoaded() || bIsGenerating)
+	{
+		return;
+	}
+
+	// Tokenized on the worker; holding back the tail happens there too
+	StartPrefill(PartialPrompt, TArray<llama_token>());
+}
+
+void ULlamaCppInference::PrefillConversationAsync(ULlamaConversation* Conversation, const FString& PartialUserText)
+{
+	if (!IsModelLoaded() || bIsGenerating)
+	{
+		return;
+	}
+
+	TArray<llama_token> Tokens;
+	if (!Conversation || !Conversation->BuildPendingTokens(Model, TEXT("user"), PartialUserText, Tokens))
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Failed to build conversation prompt for prefill"));
+		return;
+	}
+	StartPrefill(FString(), MoveTemp(Tokens));
+}
+
+void ULlamaCppInference::StartPrefill(const FString& PartialPrompt, TArray<llama_token>&& Tokens)
+{
+	const int32 Serial = ++PrefillSerial;
+	const int32 Holdback = FMath::Max(0, PrefillHoldbackTokens);
+	const int32 ChunkSize = PrefillChunkTokens;
+	++NumPrefillWorkers;
+	FEvent* DoneEvent = GenerationDoneEvent;
+
+	// BeginDestroy and UnloadModel wait for NumPrefillWorkers, so the worker may use this until it decrements it
+	Async(EAsyncExecution::Thread, [this, PartialPrompt, Tokens = MoveTemp(Tokens), Serial, Holdback, ChunkSize, DoneEvent]() mutable
+	{
+		// A newer partial or a real request makes this one pointless
+		auto ShouldStop = [this, Serial]() { return bIsGenerating || PrefillSerial != Serial; };
+
+		{
+			FScopeLock ContextScope(&ContextLock);
+			if (!ShouldStop() && (Tokens.Num() > 0 || TokenizeUtf8(Vocab, TCHAR_TO_UTF8(*PartialPrompt), true, Tokens)))
+			{
+				// The last words of a partial transcript and the template's end-of-turn tokens are the most
+				// likely to differ in the final prompt; decoding them would only be rolled back
+				Tokens.SetNum(FMath::Max(0, Tokens.Num() - Holdback));
+				PrefillTokens(Ctx, Tokens, ChunkSize, KvTokens, ShouldStop);
+			}
+		}
+
+		DoneEvent->Trigger();
+		--NumPrefillWorkers;
+	});
+}
+
+float ULlamaCppInference::GetMeanTokenEntropy() const
+{
+	return TokenEntropyCount > 0 ? TokenEntropySum / TokenEntropyCount : 0.0f;
+}
+
+void ULlamaCppInference::ResetTokenEntropy()
+{
+	TokenEntropySum = 0.0f;
+	TokenEntropyCount = 0;
+}
+
+void ULlamaCppInference::RecordTokenEntropy(float Entropy)
+{
+	TokenEntropySum += Entropy;
+	++TokenEntropyCount;
+}
+
+void ULlamaCppInference::ClearExactCache()
+{
+	ExactCache->Empty();
+}
+
+FLlamaGenerationCache* ULlamaCppInference::GetExactCache()
+{
+	if (!bEnableExactCache)
+	{
+		return nullptr;
+	}
+	ExactCache->SetMaxBytes(ExactCacheMaxBytes);
+	return ExactCache.Get();
+}
+
 void ULlamaCppInference::StopGeneration()
 {
-	bCancelGeneration = true;
+	if (ActiveStream)
+	{
+		ActiveStream->Cancel();
+	}
+
+	TArray<TSharedPtr<FQueuedRequest>> Dropped;
+	{
+		FScopeLock Lock(&QueueLock);
+		for (const TSharedPtr<FQueuedRequest>& Request : ActiveRequests)
+		{
+			Request->bCancelled = true;
+		}
+		Dropped = MoveTemp(PendingRequests);
+		PendingRequests.Reset();
+	}
+
+	for (const TSharedPtr<FQueuedRequest>& Request : Dropped)
+	{
+		OnRequestComplete.Broadcast(Request->RequestId, TEXT(""));
+	}
+}
+
+int32 ULlamaCppInference::EnqueueGeneration(const FString& Prompt, int32 MaxTokens, FLlamaSamplingParams SamplingParams,
+	ELlamaRequestPriority Priority)
+{
+	if (!IsModelLoaded())
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Cannot enqueue generation — no model loaded"));
+		return INDEX_NONE;
+	}
+
+	TSharedPtr<FQueuedRequest> Request = MakeShared<FQueuedRequest>();
+	Request->RequestId = NextRequestId++;
+	Request->Priority = Priority;
+	Request->Prompt = Prompt;
+	Request->MaxTokens = MaxTokens;
+	Request->SamplingParams = ResolveSamplingParams(SamplingParams);
+	if (RequestDeadlineSeconds > 0.0f)
+	{
+		// Time spent waiting in the queue counts against the deadline
+		Request->Deadline = FPlatformTime::Seconds() + RequestDeadlineSeconds;
+	}
+
+	{
+		FScopeLock Lock(&QueueLock);
+		PendingRequests.Add(Request);
+		if (ActiveRequests.Num() > 0 && Priority > ActiveRequests.Last()->Priority)
+		{
+			bPreemptRequested = true;
+		}
+	}
+
+	PumpRequestQueue();
+	return Request->RequestId;
+}
+
+void ULlamaCppInference::CancelRequest(int32 RequestId)
+{
+	bool bWasPending = false;
+	{
+		FScopeLock Lock(&QueueLock);
+		bWasPending = PendingRequests.RemoveAll([RequestId](const TSharedPtr<FQueuedRequest>& Request)
+		{
+			return Request->RequestId == RequestId;
+		}) > 0;
+
+		for (const TSharedPtr<FQueuedRequest>& Request : ActiveRequests)
+		{
+			if (Request->RequestId == RequestId)
+			{
+				Request->bCancelled = true;
+			}
+		}
+	}
+
+	if (bWasPending)
+	{
+		OnRequestComplete.Broadcast(RequestId, TEXT(""));
+	}
+}
+
+void ULlamaCppInference::PumpRequestQueue()
+{
+	{
+		FScopeLock Lock(&QueueLock);
+		if (bIsGenerating || PendingRequests.Num() == 0 || !IsModelLoaded())
+		{
+			return;
+		}
+		bIsGenerating = true;
+	}
+
+	// BeginDestroy waits for bIsGenerating, so the worker may use this directly until it clears the flag
+	TWeakObjectPtr<ULlamaCppInference> WeakThis(this);
+	TAtomic<bool>* GeneratingFlag = &bIsGenerating;
+	FEvent* DoneEvent = GenerationDoneEvent;
+
+	Async(EAsyncExecution::Thread, [this, WeakThis, GeneratingFlag, DoneEvent]()
+	{
+		for (;;)
+		{
+			TSharedPtr<FQueuedRequest> Request;
+			{
+				FScopeLock Lock(&QueueLock);
+				Request = PopPendingRequest(0);
+			}
+			if (!Request)
+			{
+				break;
+			}
+			FScopeLock ContextScope(&ContextLock);
+			RunQueuedRequest(Request);
+		}
+
+		// Trigger first, and clearing the flag is the last touch of this: BeginDestroy may finish right after
+		DoneEvent->Trigger();
+		*GeneratingFlag = false;
+
+		// A request enqueued between the last pop and the clear saw the flag still set and did not start a worker
+		AsyncTask(ENamedThreads::GameThread, [WeakThis]()
+		{
+			if (ULlamaCppInference* Self = WeakThis.Get())
+			{
+				Self->PumpRequestQueue();
+			}
+		});
+	});
+}
+
+TSharedPtr<ULlamaCppInference::FQueuedRequest> ULlamaCppInference::PopPendingRequest(int32 MinPriority)
+{
+	// Highest priority first, oldest first within a priority
+	int32 Best = INDEX_NONE;
+	for (int32 i = 0; i < PendingRequests.Num(); ++i)
+	{
+		const int32 Priority = static_cast<int32>(PendingRequests[i]->Priority);
+		if (Priority >= MinPriority && (Best == INDEX_NONE || Priority > static_cast<int32>(PendingRequests[Best]->Priority)))
+		{
+			Best = i;
+		}
+	}
+
+	if (Best == INDEX_NONE)
+	{
+		return nullptr;
+	}
+	TSharedPtr<FQueuedRequest> Request = PendingRequests[Best];
+	PendingRequests.RemoveAt(Best);
+	return Request;
+}
+
+void ULlamaCppInference::RunQueuedRequest(const TSharedPtr<FQueuedRequest>& Request)
+{
+	{
+		FScopeLock Lock(&QueueLock);
+		ActiveRequests.Add(Request);
+	}
+
+	TWeakObjectPtr<ULlamaCppInference> WeakThis(this);
+	const int32 RequestId = Request->RequestId;
+
+	FGenerationOptions GenOptions = MakeOptions(*this, Ctx);
+	GenOptions.Deadline = Request->Deadline;
+	GenOptions.OnPreemptionPoint = [this]()
+	{
+		if (bPreemptRequested)
+		{
+			ServicePreemption();
+		}
+	};
+
+	TArray<llama_token> OutTokens;
+	std::string OutText;
+	TArray<llama_token> PromptTokens;
+	if (!Request->bCancelled && TokenizePrompt(Vocab, Request->Prompt, PromptTokens))
+	{
+		RunGeneration(Ctx, Vocab, PromptTokens, Request->MaxTokens, Request->SamplingParams, GenOptions, Request->bCancelled,
+			GetExactCache(), *SamplerCache, KvTokens,
+			[WeakThis, RequestId](TArrayView<const llama_token>, FUtf8StringView Text, float)
+			{
+				AsyncTask(ENamedThreads::GameThread, [WeakThis, RequestId, TokenStr = Utf8ToString(Text)]()
+				{
+					if (auto* Self = WeakThis.Get())
+						Self->OnRequestTokenGenerated.Broadcast(RequestId, TokenStr);
+				});
+			},
+			OutTokens, OutText);
+	}
+	FString FullResult = UTF8_TO_TCHAR(OutText.c_str());
+
+	{
+		FScopeLock Lock(&QueueLock);
+		ActiveRequests.Remove(Request);
+	}
+
+	AsyncTask(ENamedThreads::GameThread, [WeakThis, RequestId, FullResult]()
+	{
+		if (auto* Self = WeakThis.Get())
+			Self->OnRequestComplete.Broadcast(RequestId, FullResult);
+	});
+}
+
+void ULlamaCppInference::ServicePreemption()
+{
+	bPreemptRequested = false;
+
+	TSharedPtr<FQueuedRequest> Preempted;
+	{
+		FScopeLock Lock(&QueueLock);
+		Preempted = ActiveRequests.Last();
+	}
+
+	llama_memory_t Mem = llama_get_memory(Ctx);
+	TArray<uint8> SavedState;
+	TArray<llama_token> SavedKvTokens;
+	bool bSaved = false;
+	bool bStateCaptured = false;
+
+	for (;;)
+	{
+		TSharedPtr<FQueuedRequest> Urgent;
+		{
+			FScopeLock Lock(&QueueLock);
+			Urgent = PopPendingRequest(static_cast<int32>(Preempted->Priority) + 1);
+		}
+		if (!Urgent)
+		{
+			break;
+		}
+
+		if (!bSaved)
+		{
+			bSaved = true;
+			SavedKvTokens = KvTokens;
+			if (StateBufferPool.Num() > 0)
+			{
+				SavedState = StateBufferPool.Pop();
+			}
+			const size_t StateSize = llama_state_seq_get_size(Ctx, 0);
+			SavedState.SetNumUninitialized(static_cast<int32>(StateSize));
+			bStateCaptured = llama_state_seq_get_data(Ctx, SavedState.GetData(), StateSize, 0) == StateSize;
+			UE_LOG(LogLlamaCpp, Verbose, TEXT("LlamaCpp: Request %d preempted by %d (%d bytes of sequence state saved)"),
+				Preempted->RequestId, Urgent->RequestId, bStateCaptured ? SavedState.Num() : 0);
+		}
+
+		RunQueuedRequest(Urgent);
+	}
+
+	if (!bSaved)
+	{
+		return;
+	}
+
+	// Put the preempted sequence back; if the saved state cannot be applied, recompute it from its tokens
+	llama_memory_seq_rm(Mem, 0, -1, -1);
+	bool bRestored = bStateCaptured && llama_state_seq_set_data(Ctx, SavedState.GetData(), SavedState.Num(), 0) != 0;
+	if (!bRestored)
+	{
+		llama_memory_seq_rm(Mem, 0, -1, -1);
+		bRestored = SavedKvTokens.Num() == 0 || DecodeTokensChunked(Ctx, SavedKvTokens, 0, 0);
+	}
+
+	if (bRestored)
+	{
+		KvTokens = MoveTemp(SavedKvTokens);
+	}
+	else
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to restore preempted request %d"), Preempted->RequestId);
+		llama_memory_seq_rm(Mem, 0, -1, -1);
+		KvTokens.Reset();
+		Preempted->bCancelled = true;
+	}
+
+	StateBufferPool.Push(MoveTemp(SavedState));
+}
+
+void ULlamaCppInference::ScoreOptionsAsync(const FString& Prompt, const TArray<FString>& Options)
+{
+	if (!IsModelLoaded())
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Cannot score options — no model loaded"));
+		OnOptionsScored.Broadcast(TArray<FLlamaOptionScore>(), INDEX_NONE);
+		return;
+	}
+
+	if (bIsGenerating)
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Generation already in progress"));
+		return;
+	}
+
+	if (Options.Num() == 0)
+	{
+		OnOptionsScored.Broadcast(TArray<FLlamaOptionScore>(), INDEX_NONE);
+		return;
+	}
+
+	bIsGenerating = true;
+	ResetTokenEntropy();
+
+	TWeakObjectPtr<ULlamaCppInference> WeakThis(this);
+	FString PromptCopy = Prompt;
+	TArray<FString> OptionsCopy = Options;
+
+	llama_context* BgCtx = Ctx;
+	const llama_vocab* BgVocab = Vocab;
+	TArray<llama_token>* BgKvTokens = &KvTokens;
+	FCriticalSection* BgContextLock = &ContextLock;
+	TAtomic<bool>* GeneratingFlag = &bIsGenerating;
+	FEvent* DoneEvent = GenerationDoneEvent;
+
+	Async(EAsyncExecution::Thread, [WeakThis, PromptCopy, OptionsCopy, BgCtx, BgVocab, BgKvTokens, BgContextLock, GeneratingFlag, DoneEvent]()
+	{
+		FScopeLock ContextScope(BgContextLock);
+
+		// Scoring uses the whole KV cache, so nothing can be reused afterwards
+		BgKvTokens->Reset();
+
+		TArray<FLlamaOptionScore> Scores;
+		Scores.SetNum(OptionsCopy.Num());
+		int32 BestIndex = INDEX_NONE;
+
+		llama_memory_t Mem = llama_get_memory(BgCtx);
+		llama_memory_clear(Mem, true);
+
+		const int32 NVocab = llama_vocab_n_tokens(BgVocab);
+		const int32 BatchSize = static_cast<int32>(llama_n_batch(BgCtx));
+		// Sequence 0 holds the prompt, option i of a group goes into sequence i + 1
+		const int32 MaxOptionsPerBatch = FMath::Max(1, static_cast<int32>(llama_n_seq_max(BgCtx)) - 1);
+
+		TArray<llama_token> PromptTokens;
+		TArray<TArray<llama_token>> OptionTokens;
+		OptionTokens.SetNum(OptionsCopy.Num());
+
+		bool bOk = TokenizeUtf8(BgVocab, TCHAR_TO_UTF8(*PromptCopy), true, PromptTokens) && PromptTokens.Num() > 0;
+		for (int32 i = 0; i < OptionsCopy.Num() && bOk; ++i)
+		{
+			Scores[i].Option = OptionsCopy[i];
+			TokenizeUtf8(BgVocab, TCHAR_TO_UTF8(*OptionsCopy[i]), false, OptionTokens[i]);
+			if (OptionTokens[i].Num() > BatchSize)
+			{
+				UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Option %d exceeds batch size, truncating to %d tokens"), i, BatchSize);
+				OptionTokens[i].SetNum(BatchSize);
+			}
+		}
+
+		if (!bOk || !DecodeTokensChunked(BgCtx, PromptTokens, 0, 0))
+		{
+			UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to prefill prompt for option scoring"));
+			bOk = false;
+		}
+
+		if (bOk)
+		{
+			// The first token of every option is predicted by the prompt's last logits,
+			// which the option batch below overwrites — score them now.
+			const float* PromptLogits = llama_get_logits_ith(BgCtx, -1);
+			const float PromptLse = LogSumExp(PromptLogits, NVocab);
+			for (int32 i = 0; i < OptionTokens.Num(); ++i)
+			{
+				if (OptionTokens[i].Num() > 0)
+				{
+					Scores[i].LogLikelihood = PromptLogits[OptionTokens[i][0]] - PromptLse;
+					Scores[i].NumTokens = 1;
+				}
+			}
+
+			const llama_pos NPrompt = PromptTokens.Num();
+			llama_batch Batch = llama_batch_init(BatchSize, 0, 1);
+			TArray<int32> GroupOptions;
+			TArray<int32> GroupFirstIndex;
+
+			int32 Next = 0;
+			while (Next < OptionTokens.Num() && bOk)
+			{
+				// Pack as many options as fit into the sequence and batch limits
+				GroupOptions.Reset();
+				GroupFirstIndex.Reset();
+				Batch.n_tokens = 0;
+
+				while (Next < OptionTokens.Num() && GroupOptions.Num() < MaxOptionsPerBatch
+					&& Batch.n_tokens + OptionTokens[Next].Num() <= BatchSize)
+				{
+					const TArray<llama_token>& Tokens = OptionTokens[Next];
+					const llama_seq_id SeqId = GroupOptions.Num() + 1;
+
+					GroupOptions.Add(Next);
+					GroupFirstIndex.Add(Batch.n_tokens);
+					llama_memory_seq_cp(Mem, 0, SeqId, -1, -1);
+
+					for (int32 k = 0; k < Tokens.Num(); ++k)
+					{
+						const int32 Idx = Batch.n_tokens++;
+						Batch.token[Idx] = Tokens[k];
+						Batch.pos[Idx] = NPrompt + k;
+						Batch.n_seq_id[Idx] = 1;
+						Batch.seq_id[Idx][0] = SeqId;
+						// Logits at token k predict token k + 1; the last token's prediction is unused
+						Batch.logits[Idx] = (k < Tokens.Num() - 1);
+					}
+					++Next;
+				}
+
+				if (Batch.n_tokens > 0 && llama_decode(BgCtx, Batch) != 0)
+				{
+					UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to decode option batch"));
+					bOk = false;
+				}
+
+				for (int32 g = 0; g < GroupOptions.Num() && bOk; ++g)
+				{
+					const TArray<llama_token>& Tokens = OptionTokens[GroupOptions[g]];
+					FLlamaOptionScore& Score = Scores[GroupOptions[g]];
+
+					for (int32 k = 1; k < Tokens.Num(); ++k)
+					{
+						const float* Logits = llama_get_logits_ith(BgCtx, GroupFirstIndex[g] + k - 1);
+						Score.LogLikelihood += Logits[Tokens[k]] - LogSumExp(Logits, NVocab);
+						++Score.NumTokens;
+					}
+				}
+
+				for (int32 g = 0; g < GroupOptions.Num(); ++g)
+				{
+					llama_memory_seq_rm(Mem, g + 1, -1, -1);
+				}
+			}
+
+			llama_batch_free(Batch);
+		}
+
+		if (bOk)
+		{
+			float MaxNormalized = -MAX_flt;
+			for (int32 i = 0; i < Scores.Num(); ++i)
+			{
+				FLlamaOptionScore& Score = Scores[i];
+				Score.NormalizedLogLikelihood = Score.NumTokens > 0 ? Score.LogLikelihood / Score.NumTokens : -MAX_flt;
+				if (Score.NumTokens > 0 && Score.NormalizedLogLikelihood > MaxNormalized)
+				{
+					MaxNormalized = Score.NormalizedLogLikelihood;
+					BestIndex = i;
+				}
+			}
+
+			double SumExp = 0.0;
+			for (const FLlamaOptionScore& Score : Scores)
+			{
+				SumExp += Score.NumTokens > 0 ? FMath::Exp(Score.NormalizedLogLikelihood - MaxNormalized) : 0.0;
+			}
+			for (FLlamaOptionScore& Score : Scores)
+			{
+				Score.Probability = (Score.NumTokens > 0 && SumExp > 0.0)
+					? static_cast<float>(FMath::Exp(Score.NormalizedLogLikelihood - MaxNormalized) / SumExp)
+					: 0.0f;
+			}
+		}
+		else
+		{
+			Scores.Reset();
+		}
+
+		ContextScope.Unlock();
+		DoneEvent->Trigger();
+		*GeneratingFlag = false;
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Scores, BestIndex]()
+		{
+			if (auto* Self = WeakThis.Get())
+			{
+				Self->OnOptionsScored.Broadcast(Scores, BestIndex);
+				Self->PumpRequestQueue();
+			}
+		});
+	});
 }
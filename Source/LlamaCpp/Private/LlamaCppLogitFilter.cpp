@@ -0,0 +1,259 @@
+#include "LlamaCppLogitFilter.h"
+#include "LlamaCppCompiledLogitFilter.h"
+#include "Hash/CityHash.h"
+#include <string>
+#include "LlamaCppLog.h"
+
+namespace
+{
+	/** Tokenize Text as plain text (no special tokens) and, with bVariants, its mid-sentence and capitalized forms. */
+	void TokenizeVariants(const llama_vocab* Vocab, const FString& Text, bool bVariants, TArray<TArray<llama_token>>& OutVariants)
+	{
+		OutVariants.Reset();
+		if (Text.IsEmpty())
+		{
+			return;
+		}
+
+		TArray<FString> Forms = { Text };
+		if (bVariants)
+		{
+			FString Capitalized = Text;
+			Capitalized[0] = FChar::ToUpper(Capitalized[0]);
+			Forms.AddUnique(Capitalized);
+			Forms.AddUnique(TEXT(" ") + Text);
+			Forms.AddUnique(TEXT(" ") + Capitalized);
+		}
+
+		for (const FString& Form : Forms)
+		{
+			const std::string Utf8 = TCHAR_TO_UTF8(*Form);
+			int32_t NTokens = -llama_tokenize(Vocab, Utf8.c_str(), Utf8.size(), nullptr, 0, false, false);
+			if (NTokens <= 0)
+			{
+				continue;
+			}
+			TArray<llama_token> Tokens;
+			Tokens.SetNum(NTokens);
+			llama_tokenize(Vocab, Utf8.c_str(), Utf8.size(), Tokens.GetData(), Tokens.Num(), false, false);
+			OutVariants.AddUnique(MoveTemp(Tokens));
+		}
+	}
+
+	// --- Banned-phrase sampler ---
+
+	struct FBannedPhraseState
+	{
+		TSharedPtr<const FLlamaCompiledLogitFilter, ESPMode::ThreadSafe> Filter;
+		// Last accepted tokens, at most MaxSequenceLength - 1
+		TArray<llama_token> History;
+	};
+
+	void ForbidToken(llama_token_data_array* CurP, llama_token Token)
+	{
+		// The first stage of a chain still sees the candidates in vocabulary order
+		if (Token >= 0 && static_cast<size_t>(Token) < CurP->size && CurP->data[Token].id == Token)
+		{
+			CurP->data[Token].logit = -INFINITY;
+			return;
+		}
+		for (size_t i = 0; i < CurP->size; ++i)
+		{
+			if (CurP->data[i].id == Token)
+			{
+				CurP->data[i].logit = -INFINITY;
+				return;
+			}
+		}
+	}
+
+	const char* BannedPhraseName(const llama_sampler*)
+	{
+		return "banned-phrases";
+	}
+
+	void BannedPhraseAccept(llama_sampler* Smpl, llama_token Token)
+	{
+		FBannedPhraseState* State = static_cast<FBannedPhraseState*>(Smpl->ctx);
+		State->History.Add(Token);
+		if (State->History.Num() >= State->Filter->MaxSequenceLength)
+		{
+			State->History.RemoveAt(0);
+		}
+	}
+
+	void BannedPhraseApply(llama_sampler* Smpl, llama_token_data_array* CurP)
+	{
+		const FBannedPhraseState* State = static_cast<const FBannedPhraseState*>(Smpl->ctx);
+		const TArray<llama_token>& History = State->History;
+		if (History.Num() == 0)
+		{
+			return;
+		}
+
+		// Forbid the token that would complete any phrase whose other tokens were just generated
+		for (auto It = State->Filter->SequencesByLastPrefixToken.CreateConstKeyIterator(History.Last()); It; ++It)
+		{
+			const TArray<llama_token>& Sequence = State->Filter->BannedSequences[It.Value()];
+			const int32 PrefixLength = Sequence.Num() - 1;
+			if (PrefixLength > History.Num())
+			{
+				continue;
+			}
+
+			const int32 Offset = History.Num() - PrefixLength;
+			bool bMatch = true;
+			for (int32 k = 0; k < PrefixLength - 1 && bMatch; ++k)
+			{
+				bMatch = History[Offset + k] == Sequence[k];
+			}
+			if (bMatch)
+			{
+				ForbidToken(CurP, Sequence.Last());
+			}
+		}
+	}
+
+	void BannedPhraseReset(llama_sampler* Smpl)
+	{
+		static_cast<FBannedPhraseState*>(Smpl->ctx)->History.Reset();
+	}
+
+	llama_sampler* BannedPhraseClone(const llama_sampler* Smpl);
+
+	void BannedPhraseFree(llama_sampler* Smpl)
+	{
+		delete static_cast<FBannedPhraseState*>(Smpl->ctx);
+	}
+
+	llama_sampler_i BannedPhraseInterface = {
+		BannedPhraseName,
+		BannedPhraseAccept,
+		BannedPhraseApply,
+		BannedPhraseReset,
+		BannedPhraseClone,
+		BannedPhraseFree,
+		// CPU only; no backend sampling
+		nullptr,
+		nullptr,
+		nullptr,
+		nullptr,
+	};
+
+	llama_sampler* BannedPhraseClone(const llama_sampler* Smpl)
+	{
+		const FBannedPhraseState* State = static_cast<const FBannedPhraseState*>(Smpl->ctx);
+		return llama_sampler_init(&BannedPhraseInterface, new FBannedPhraseState(*State));
+	}
+}
+
+void AddLogitFilterSamplers(llama_sampler* Chain, const TSharedPtr<const FLlamaCompiledLogitFilter, ESPMode::ThreadSafe>& Filter, int32 NumVocab)
+{
+	if (!Filter)
+	{
+		return;
+	}
+
+	if (Filter->Biases.Num() > 0)
+	{
+		llama_sampler_chain_add(Chain, llama_sampler_init_logit_bias(NumVocab, Filter->Biases.Num(), Filter->Biases.GetData()));
+	}
+
+	if (Filter->BannedSequences.Num() > 0)
+	{
+		FBannedPhraseState* State = new FBannedPhraseState();
+		State->Filter = Filter;
+		llama_sampler_chain_add(Chain, llama_sampler_init(&BannedPhraseInterface, State));
+	}
+}
+
+uint64 ULlamaCppLogitFilter::HashSource() const
+{
+	uint64 Hash = bMatchVariants ? 1 : 0;
+	for (const FLlamaLogitBias& Entry : Biases)
+	{
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(*Entry.Text), Entry.Text.Len() * sizeof(TCHAR), Hash);
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(&Entry.Bias), sizeof(Entry.Bias), Hash);
+	}
+	// Separates the lists so moving an entry from one to the other changes the hash
+	Hash = CityHash64WithSeed("|", 1, Hash);
+	for (const FString& Phrase : BannedPhrases)
+	{
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(*Phrase), Phrase.Len() * sizeof(TCHAR), Hash);
+	}
+	return Hash;
+}
+
+TSharedPtr<const FLlamaCompiledLogitFilter, ESPMode::ThreadSafe> ULlamaCppLogitFilter::Compile(const llama_model* Model)
+{
+	if (!Model)
+	{
+		return nullptr;
+	}
+
+	const uint64 SourceHash = HashSource();
+	if (Compiled && Model == CompiledModel && SourceHash == CompiledSourceHash)
+	{
+		return Compiled;
+	}
+
+	const llama_vocab* Vocab = llama_model_get_vocab(Model);
+	TSharedRef<FLlamaCompiledLogitFilter, ESPMode::ThreadSafe> Result = MakeShared<FLlamaCompiledLogitFilter, ESPMode::ThreadSafe>();
+	Result->SourceHash = SourceHash;
+
+	TMap<llama_token, float> BiasByToken;
+	TArray<TArray<llama_token>> Variants;
+
+	for (const FLlamaLogitBias& Entry : Biases)
+	{
+		TokenizeVariants(Vocab, Entry.Text, bMatchVariants, Variants);
+
+		// A token shared by several variants is biased once
+		TSet<llama_token> EntryTokens;
+		for (const TArray<llama_token>& Tokens : Variants)
+		{
+			EntryTokens.Append(Tokens);
+		}
+		for (llama_token Token : EntryTokens)
+		{
+			BiasByToken.FindOrAdd(Token) += Entry.Bias;
+		}
+	}
+
+	for (const FString& Phrase : BannedPhrases)
+	{
+		TokenizeVariants(Vocab, Phrase, bMatchVariants, Variants);
+		for (TArray<llama_token>& Tokens : Variants)
+		{
+			if (Tokens.Num() == 1)
+			{
+				BiasByToken.FindOrAdd(Tokens[0]) = -INFINITY;
+			}
+			else
+			{
+				Result->BannedSequences.AddUnique(MoveTemp(Tokens));
+			}
+		}
+	}
+
+	Result->Biases.Reserve(BiasByToken.Num());
+	for (const TPair<llama_token, float>& Pair : BiasByToken)
+	{
+		Result->Biases.Add({ Pair.Key, Pair.Value });
+	}
+
+	for (int32 i = 0; i < Result->BannedSequences.Num(); ++i)
+	{
+		const TArray<llama_token>& Sequence = Result->BannedSequences[i];
+		Result->SequencesByLastPrefixToken.Add(Sequence[Sequence.Num() - 2], i);
+		Result->MaxSequenceLength = FMath::Max(Result->MaxSequenceLength, Sequence.Num());
+	}
+
+	UE_LOG(LogLlamaCpp, Verbose, TEXT("LlamaCpp: Compiled logit filter (%d biased tokens, %d banned sequences)"),
+		Result->Biases.Num(), Result->BannedSequences.Num());
+
+	CompiledModel = Model;
+	CompiledSourceHash = SourceHash;
+	Compiled = Result;
+	return Compiled;
+}
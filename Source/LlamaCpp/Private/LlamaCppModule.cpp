@@ -2,7 +2,9 @@
 #include "Interfaces/IPluginManager.h"
 #include "Misc/Paths.h"
 #include "HAL/PlatformProcess.h"
+#include "RenderCore.h"
 #include "llama.h"
+#include "LlamaCppFrameBudget.h"
 #include "LlamaCppLog.h"
 
 DEFINE_LOG_CATEGORY(LogLlamaCpp);
@@ -69,10 +71,21 @@ void FLlamaCppModule::StartupModule()
 
 	llama_backend_init();
 	UE_LOG(LogLlamaCpp, Log, TEXT("LlamaCpp: backend initialized"));
+
+	// Publish frame work time for budget-aware generation. Not DeltaTime: with vsync that is the refresh
+	// period however light the frame is, so it never shows headroom
+	FrameBudgetTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([](float DeltaTime)
+	{
+		const uint32 WorkCycles = FMath::Max(GGameThreadTime, GRenderThreadTime);
+		FLlamaFrameBudget::Publish(WorkCycles > 0 ? static_cast<float>(FPlatformTime::ToSeconds(WorkCycles)) : DeltaTime);
+		return true;
+	}));
 }
 
 void FLlamaCppModule::ShutdownModule()
 {
+	FTSTicker::GetCoreTicker().RemoveTicker(FrameBudgetTickerHandle);
+
 	llama_backend_free();
 	UE_LOG(LogLlamaCpp, Log, TEXT("LlamaCpp: backend freed"));
 
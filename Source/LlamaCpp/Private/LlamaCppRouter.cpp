@@ -0,0 +1,234 @@
+#include "LlamaCppRouter.h"
+#include "LlamaCppLog.h"
+
+void ULlamaCppRouter::GenerateAsync(const FString& Prompt, const FString& Query, int32 MaxTokens, FLlamaSamplingParams SamplingParams)
+{
+	if (IsBusy())
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Router request already in progress"));
+		return;
+	}
+
+	if (Tiers.Num() == 0)
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Router has no tiers"));
+		OnGenerationComplete.Broadcast(TEXT(""), INDEX_NONE);
+		return;
+	}
+
+	for (ULlamaCppInference* Tier : Tiers)
+	{
+		if (!Tier || !Tier->IsModelLoaded() || Tier->IsGenerating())
+		{
+			UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Router needs every tier loaded and idle"));
+			OnGenerationComplete.Broadcast(TEXT(""), INDEX_NONE);
+			return;
+		}
+	}
+
+	PendingPrompt = Prompt;
+	PendingMaxTokens = MaxTokens;
+	PendingParams = SamplingParams;
+	bStopped = false;
+	if (RequestsPerTier.Num() != Tiers.Num())
+	{
+		RequestsPerTier.SetNumZeroed(Tiers.Num());
+	}
+
+	const FString& QueryText = Query.IsEmpty() ? Prompt : Query;
+	const int32 LastTier = Tiers.Num() - 1;
+
+	const int32 RuleTier = MatchRule(QueryText);
+	if (RuleTier != INDEX_NONE)
+	{
+		StartTier(RuleTier, false);
+		return;
+	}
+
+	if (Mode == ELlamaRoutingMode::RulesOnly || LastTier == 0)
+	{
+		StartTier(FMath::Clamp(DefaultTier, 0, LastTier), false);
+	}
+	else if (Mode == ELlamaRoutingMode::Classifier)
+	{
+		bClassifying = true;
+		Tiers[0]->OnOptionsScored.AddDynamic(this, &ULlamaCppRouter::HandleClassified);
+		Tiers[0]->ScoreOptionsAsync(ClassifierPrompt.Replace(TEXT("{query}"), *QueryText), { EasyLabel, HardLabel });
+	}
+	else
+	{
+		StartTier(0, true);
+	}
+}
+
+void ULlamaCppRouter::StopGeneration()
+{
+	bStopped = true;
+	bEscalating = false;
+	if (Tiers.IsValidIndex(ActiveTier) && Tiers[ActiveTier])
+	{
+		Tiers[ActiveTier]->StopGeneration();
+	}
+}
+
+int32 ULlamaCppRouter::MatchRule(const FString& Query) const
+{
+	for (const FLlamaRoutingRule& Rule : Rules)
+	{
+		if (!Tiers.IsValidIndex(Rule.Tier) || Query.Len() < Rule.MinQueryLength)
+		{
+			continue;
+		}
+
+		bool bKeywordMatch = Rule.Keywords.Num() == 0;
+		for (const FString& Keyword : Rule.Keywords)
+		{
+			if (Query.Contains(Keyword, ESearchCase::IgnoreCase))
+			{
+				bKeywordMatch = true;
+				break;
+			}
+		}
+
+		if (bKeywordMatch)
+		{
+			return Rule.Tier;
+		}
+	}
+	return INDEX_NONE;
+}
+
+void ULlamaCppRouter::StartTier(int32 Tier, bool bJudgeConfidence)
+{
+	ULlamaCppInference* Inference = Tiers[Tier];
+
+	ActiveTier = Tier;
+	bJudgingConfidence = bJudgeConfidence;
+	bEscalating = false;
+	HeldTokenCount = 0;
+	HeldText.Reset();
+
+	if (bJudgeConfidence)
+	{
+		EntropyOverrideTier = Tier;
+		bSavedMeasureTokenEntropy = Inference->bMeasureTokenEntropy;
+		Inference->bMeasureTokenEntropy = true;
+	}
+
+	Inference->OnTokenGenerated.AddDynamic(this, &ULlamaCppRouter::HandleToken);
+	Inference->OnGenerationComplete.AddDynamic(this, &ULlamaCppRouter::HandleComplete);
+
+	OnRouteSelected.Broadcast(Tier);
+	Inference->GenerateTextAsync(PendingPrompt, PendingMaxTokens, PendingParams);
+}
+
+void ULlamaCppRouter::Escalate()
+{
+	UE_LOG(LogLlamaCpp, Verbose, TEXT("LlamaCpp: Router escalating (mean entropy %.2f > %.2f)"),
+		Tiers[ActiveTier]->GetMeanTokenEntropy(), MaxMeanEntropy);
+	bEscalating = true;
+	Tiers[ActiveTier]->StopGeneration();
+}
+
+void ULlamaCppRouter::FinishRequest(const FString& FullText)
+{
+	const int32 Tier = ActiveTier;
+	ActiveTier = INDEX_NONE;
+	bJudgingConfidence = false;
+	HeldText.Reset();
+
+	if (RequestsPerTier.IsValidIndex(Tier))
+	{
+		++RequestsPerTier[Tier];
+	}
+	OnGenerationComplete.Broadcast(FullText, Tier);
+}
+
+void ULlamaCppRouter::HandleClassified(const TArray<FLlamaOptionScore>& Scores, int32 BestIndex)
+{
+	Tiers[0]->OnOptionsScored.RemoveDynamic(this, &ULlamaCppRouter::HandleClassified);
+	bClassifying = false;
+
+	if (bStopped)
+	{
+		OnGenerationComplete.Broadcast(TEXT(""), INDEX_NONE);
+		return;
+	}
+
+	const float HardProbability = Scores.Num() == 2 ? Scores[1].Probability : 0.0f;
+	UE_LOG(LogLlamaCpp, Verbose, TEXT("LlamaCpp: Router classifier P(hard)=%.2f"), HardProbability);
+
+	if (HardProbability >= HardThreshold)
+	{
+		++Escalations;
+		StartTier(Tiers.Num() - 1, false);
+	}
+	else
+	{
+		StartTier(0, false);
+	}
+}
+
+void ULlamaCppRouter::HandleToken(const FString& Token)
+{
+	if (bEscalating)
+	{
+		return;
+	}
+
+	if (!bJudgingConfidence)
+	{
+		OnTokenGenerated.Broadcast(Token);
+		return;
+	}
+
+	// Hold the first tokens back until there is enough evidence to judge the small model
+	HeldText += Token;
+	if (++HeldTokenCount < EntropyWindowTokens)
+	{
+		return;
+	}
+
+	if (Tiers[ActiveTier]->GetMeanTokenEntropy() > MaxMeanEntropy)
+	{
+		Escalate();
+	}
+	else
+	{
+		bJudgingConfidence = false;
+		OnTokenGenerated.Broadcast(HeldText);
+		HeldText.Reset();
+	}
+}
+
+void ULlamaCppRouter::HandleComplete(const FString& FullText)
+{
+	ULlamaCppInference* Inference = Tiers[ActiveTier];
+	Inference->OnTokenGenerated.RemoveDynamic(this, &ULlamaCppRouter::HandleToken);
+	Inference->OnGenerationComplete.RemoveDynamic(this, &ULlamaCppRouter::HandleComplete);
+
+	const int32 LastTier = Tiers.Num() - 1;
+
+	// Escalate when stopped mid-window, or when the whole reply fit in the window but looked unsure
+	const bool bUnsure = bJudgingConfidence && !bStopped && ActiveTier < LastTier
+		&& Inference->GetMeanTokenEntropy() > MaxMeanEntropy;
+
+	if (EntropyOverrideTier == ActiveTier)
+	{
+		Inference->bMeasureTokenEntropy = bSavedMeasureTokenEntropy;
+		EntropyOverrideTier = INDEX_NONE;
+	}
+
+	if ((bEscalating && !bStopped) || bUnsure)
+	{
+		++Escalations;
+		StartTier(LastTier, false);
+		return;
+	}
+
+	if (!HeldText.IsEmpty())
+	{
+		OnTokenGenerated.Broadcast(HeldText);
+	}
+	FinishRequest(FullText);
+}
@@ -0,0 +1,187 @@
+#include "LlamaCppSamplerCache.h"
+#include "LlamaCppCompiledLogitFilter.h"
+#include "Hash/CityHash.h"
+#include <string>
+
+namespace
+{
+	template <typename T>
+	uint64 HashValue(uint64 Hash, const T& Value)
+	{
+		return CityHash64WithSeed(reinterpret_cast<const char*>(&Value), sizeof(T), Hash);
+	}
+}
+
+FLlamaSamplerCache::~FLlamaSamplerCache()
+{
+	for (const FEntry& Entry : Entries)
+	{
+		llama_sampler_free(Entry.Sampler);
+	}
+}
+
+uint32 FLlamaSamplerCache::GetSeed(const FLlamaSamplingParams& Params)
+{
+	return Params.Seed < 0 ? LLAMA_DEFAULT_SEED : static_cast<uint32>(Params.Seed);
+}
+
+uint64 FLlamaSamplerCache::HashParams(const FLlamaSamplingParams& Params, uint64 Hash)
+{
+	Hash = HashValue(Hash, Params.Temperature);
+	Hash = HashValue(Hash, Params.TopK);
+	Hash = HashValue(Hash, Params.TopP);
+	Hash = HashValue(Hash, Params.MinP);
+	Hash = HashValue(Hash, Params.RepeatPenalty);
+	Hash = HashValue(Hash, Params.Seed);
+	Hash = HashValue(Hash, Params.PenaltyLastN);
+	Hash = HashValue(Hash, Params.FrequencyPenalty);
+	Hash = HashValue(Hash, Params.PresencePenalty);
+	Hash = HashValue(Hash, Params.DryMultiplier);
+	Hash = HashValue(Hash, Params.DryBase);
+	Hash = HashValue(Hash, Params.DryAllowedLength);
+	Hash = HashValue(Hash, Params.DryPenaltyLastN);
+	for (const FString& Breaker : Params.DrySequenceBreakers)
+	{
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(*Breaker), Breaker.Len() * sizeof(TCHAR), Hash);
+		Hash = HashValue(Hash, Breaker.Len());
+	}
+	Hash = HashValue(Hash, Params.XtcProbability);
+	Hash = HashValue(Hash, Params.XtcThreshold);
+	Hash = HashValue(Hash, Params.Mirostat);
+	Hash = HashValue(Hash, Params.MirostatTau);
+	Hash = HashValue(Hash, Params.MirostatEta);
+	Hash = HashValue(Hash, Params.CompiledLogitFilter ? Params.CompiledLogitFilter->SourceHash : 0);
+	return Hash;
+}
+
+llama_sampler* FLlamaSamplerCache::BuildChain(const llama_model* Model, const FLlamaSamplingParams& Params)
+{
+	const llama_vocab* Vocab = llama_model_get_vocab(Model);
+	const uint32 Seed = GetSeed(Params);
+
+	auto ChainParams = llama_sampler_chain_default_params();
+	ChainParams.no_perf = true;
+	llama_sampler* Chain = llama_sampler_chain_init(ChainParams);
+
+	// Biases and bans see the raw logits, before any other stage
+	AddLogitFilterSamplers(Chain, Params.CompiledLogitFilter, llama_vocab_n_tokens(Vocab));
+
+	llama_sampler_chain_add(Chain, llama_sampler_init_penalties(
+		Params.PenaltyLastN, Params.RepeatPenalty, Params.FrequencyPenalty, Params.PresencePenalty));
+
+	if (Params.DryMultiplier > 0.0f)
+	{
+		// llama_sampler_init_dry copies the breakers
+		TArray<std::string> Breakers;
+		TArray<const char*> BreakerPtrs;
+		Breakers.Reserve(Params.DrySequenceBreakers.Num());
+		for (const FString& Breaker : Params.DrySequenceBreakers)
+		{
+			BreakerPtrs.Add(Breakers.Add_GetRef(TCHAR_TO_UTF8(*Breaker)).c_str());
+		}
+		llama_sampler_chain_add(Chain, llama_sampler_init_dry(Vocab, llama_model_n_ctx_train(Model), Params.DryMultiplier,
+			Params.DryBase, Params.DryAllowedLength, Params.DryPenaltyLastN, BreakerPtrs.GetData(), BreakerPtrs.Num()));
+	}
+
+	switch (Params.Mirostat)
+	{
+	case ELlamaMirostat::V1:
+		llama_sampler_chain_add(Chain, llama_sampler_init_temp(Params.Temperature));
+		llama_sampler_chain_add(Chain, llama_sampler_init_mirostat(llama_vocab_n_tokens(Vocab), Seed, Params.MirostatTau, Params.MirostatEta, 100));
+		break;
+
+	case ELlamaMirostat::V2:
+		llama_sampler_chain_add(Chain, llama_sampler_init_temp(Params.Temperature));
+		llama_sampler_chain_add(Chain, llama_sampler_init_mirostat_v2(Seed, Params.MirostatTau, Params.MirostatEta));
+		break;
+
+	default:
+		llama_sampler_chain_add(Chain, llama_sampler_init_top_k(Params.TopK));
+		llama_sampler_chain_add(Chain, llama_sampler_init_top_p(Params.TopP, 1));
+		llama_sampler_chain_add(Chain, llama_sampler_init_min_p(Params.MinP, 1));
+		if (Params.XtcProbability > 0.0f)
+		{
+			llama_sampler_chain_add(Chain, llama_sampler_init_xtc(Params.XtcProbability, Params.XtcThreshold, 1, Seed));
+		}
+		llama_sampler_chain_add(Chain, llama_sampler_init_temp(Params.Temperature));
+		llama_sampler_chain_add(Chain, llama_sampler_init_dist(Seed));
+		break;
+	}
+
+	return Chain;
+}
+
+llama_sampler* FLlamaSamplerCache::Acquire(const llama_model* Model, const FLlamaSamplingParams& Params)
+{
+	const uint64 Key = HashParams(Params, 0);
+
+	FScopeLock Lock(&CacheLock);
+	for (FEntry& Entry : Entries)
+	{
+		if (Entry.Key == Key && !Entry.bInUse)
+		{
+			Entry.bInUse = true;
+			Entry.LastUsed = ++UseCounter;
+			llama_sampler_reset(Entry.Sampler);
+			return Entry.Sampler;
+		}
+	}
+
+	FEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Key = Key;
+	Entry.Sampler = BuildChain(Model, Params);
+	Entry.bInUse = true;
+	Entry.LastUsed = ++UseCounter;
+	return Entry.Sampler;
+}
+
+void FLlamaSamplerCache::Release(llama_sampler* Sampler)
+{
+	FScopeLock Lock(&CacheLock);
+	for (FEntry& Entry : Entries)
+	{
+		if (Entry.Sampler == Sampler)
+		{
+			Entry.bInUse = false;
+			break;
+		}
+	}
+	EvictIdle();
+}
+
+void FLlamaSamplerCache::Empty()
+{
+	FScopeLock Lock(&CacheLock);
+	for (int32 i = Entries.Num() - 1; i >= 0; --i)
+	{
+		if (!Entries[i].bInUse)
+		{
+			llama_sampler_free(Entries[i].Sampler);
+			Entries.RemoveAtSwap(i);
+		}
+	}
+}
+
+void FLlamaSamplerCache::EvictIdle()
+{
+	int32 NumIdle = 0;
+	for (const FEntry& Entry : Entries)
+	{
+		NumIdle += Entry.bInUse ? 0 : 1;
+	}
+
+	while (NumIdle > MaxIdleEntries)
+	{
+		int32 Oldest = INDEX_NONE;
+		for (int32 i = 0; i < Entries.Num(); ++i)
+		{
+			if (!Entries[i].bInUse && (Oldest == INDEX_NONE || Entries[i].LastUsed < Entries[Oldest].LastUsed))
+			{
+				Oldest = i;
+			}
+		}
+		llama_sampler_free(Entries[Oldest].Sampler);
+		Entries.RemoveAtSwap(Oldest);
+		--NumIdle;
+	}
+}
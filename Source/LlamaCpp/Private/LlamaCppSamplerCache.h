@@ -0,0 +1,53 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LlamaCppInference.h"
+#include "llama.h"
+
+/**
+ * Sampler chains built from FLlamaSamplingParams, kept for reuse. Building a chain allocates every
+ * stage (and DRY preprocesses its sequence breakers against the vocabulary), so chains are cached per
+ * distinct params and llama_sampler_reset between requests instead. Reset also re-seeds the dist
+ * stage: a fixed Seed repeats, a negative one draws a fresh seed.
+ */
+class FLlamaSamplerCache
+{
+public:
+	~FLlamaSamplerCache();
+
+	/** Seed passed to the random stages for Params. */
+	static uint32 GetSeed(const FLlamaSamplingParams& Params);
+
+	/** Hash of every field of Params, combined with Hash. */
+	static uint64 HashParams(const FLlamaSamplingParams& Params, uint64 Hash);
+
+	/**
+	 * A reset chain for Params, owned by the cache until Release. A chain that is in use (e.g. by a
+	 * preempted request) is never handed out twice; a second one is built instead.
+	 */
+	llama_sampler* Acquire(const llama_model* Model, const FLlamaSamplingParams& Params);
+	void Release(llama_sampler* Sampler);
+
+	/** Free every chain that is not in use. Call when the model changes. */
+	void Empty();
+
+private:
+	struct FEntry
+	{
+		uint64 Key = 0;
+		llama_sampler* Sampler = nullptr;
+		bool bInUse = false;
+		uint64 LastUsed = 0;
+	};
+
+	TArray<FEntry> Entries;
+	uint64 UseCounter = 0;
+	FCriticalSection CacheLock;
+
+	static constexpr int32 MaxIdleEntries = 8;
+
+	static llama_sampler* BuildChain(const llama_model* Model, const FLlamaSamplingParams& Params);
+
+	/** Free least recently used idle chains beyond MaxIdleEntries. Caller holds CacheLock. */
+	void EvictIdle();
+};
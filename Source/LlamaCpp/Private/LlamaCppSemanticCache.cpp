@@ -0,0 +1,236 @@
+#include "LlamaCppSemanticCache.h"
+#include "LlamaCppEmbedder.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/BufferArchive.h"
+#include "Serialization/MemoryReader.h"
+#include "LlamaCppLog.h"
+
+namespace
+{
+	constexpr uint32 SemanticCacheMagic = 0x3143534C; // "LSC1"
+	constexpr uint32 SemanticCacheVersion = 2;
+
+	/** Smallest serialized entry: the length prefixes of Scope, Vector and Response. */
+	constexpr int64 MinEntryBytes = 3 * sizeof(int32);
+}
+
+bool ULlamaCppSemanticCache::Lookup(const FString& Scope, TArrayView<const float> Vector, FString& OutResponse)
+{
+	FScopeLock Lock(&CacheLock);
+
+	int32 BestIndex = INDEX_NONE;
+	float BestScore = SimilarityThreshold;
+
+	for (int32 i = 0; i < Entries.Num(); ++i)
+	{
+		const FEntry& Entry = Entries[i];
+		if (Entry.Vector.Num() != Vector.Num() || !Entry.Scope.Equals(Scope))
+		{
+			continue;
+		}
+
+		float Score = 0.0f;
+		for (int32 d = 0; d < Vector.Num(); ++d)
+		{
+			Score += Entry.Vector[d] * Vector[d];
+		}
+		if (Score >= BestScore)
+		{
+			BestScore = Score;
+			BestIndex = i;
+		}
+	}
+
+	if (BestIndex == INDEX_NONE)
+	{
+		++Stats.Misses;
+		return false;
+	}
+
+	++Stats.Hits;
+	Entries[BestIndex].LastUsed = ++UseCounter;
+	OutResponse = Entries[BestIndex].Response;
+	return true;
+}
+
+void ULlamaCppSemanticCache::Insert(const FString& Scope, TArrayView<const float> Vector, const FString& Response)
+{
+	FScopeLock Lock(&CacheLock);
+
+	FEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Scope = Scope;
+	Entry.Vector = TArray<float>(Vector.GetData(), Vector.Num());
+	Entry.Response = Response;
+	Entry.LastUsed = ++UseCounter;
+	SizeBytes += Entry.GetSizeBytes();
+
+	EvictToFit();
+}
+
+void ULlamaCppSemanticCache::EvictToFit()
+{
+	while (Entries.Num() > 0 && (Entries.Num() > MaxEntries || SizeBytes > MaxSizeBytes))
+	{
+		int32 Oldest = 0;
+		for (int32 i = 1; i < Entries.Num(); ++i)
+		{
+			if (Entries[i].LastUsed < Entries[Oldest].LastUsed)
+			{
+				Oldest = i;
+			}
+		}
+		SizeBytes -= Entries[Oldest].GetSizeBytes();
+		Entries.RemoveAtSwap(Oldest);
+		++Stats.Evictions;
+	}
+}
+
+void ULlamaCppSemanticCache::Clear()
+{
+	FScopeLock Lock(&CacheLock);
+	Entries.Empty();
+	SizeBytes = 0;
+}
+
+void ULlamaCppSemanticCache::ClearScope(const FString& Scope)
+{
+	FScopeLock Lock(&CacheLock);
+	for (int32 i = Entries.Num() - 1; i >= 0; --i)
+	{
+		if (Entries[i].Scope.Equals(Scope))
+		{
+			SizeBytes -= Entries[i].GetSizeBytes();
+			Entries.RemoveAtSwap(i);
+		}
+	}
+}
+
+FLlamaCacheStats ULlamaCppSemanticCache::GetStats() const
+{
+	FScopeLock Lock(&CacheLock);
+	FLlamaCacheStats Result = Stats;
+	Result.NumEntries = Entries.Num();
+	Result.SizeBytes = SizeBytes;
+	return Result;
+}
+
+void ULlamaCppSemanticCache::ResetStats()
+{
+	FScopeLock Lock(&CacheLock);
+	Stats = FLlamaCacheStats();
+}
+
+bool ULlamaCppSemanticCache::SaveToFile(const FString& FilePath) const
+{
+	// Vectors are only meaningful to the model that produced them, so the file records which one that was
+	if (!Embedder || !Embedder->IsModelLoaded())
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Cannot save semantic cache without a loaded embedder"));
+		return false;
+	}
+
+	FScopeLock Lock(&CacheLock);
+
+	FBufferArchive Ar;
+	uint32 Magic = SemanticCacheMagic;
+	uint32 Version = SemanticCacheVersion;
+	int32 Dimension = Embedder->GetEmbeddingSize();
+	uint64 ModelIdentity = Embedder->GetModelIdentity();
+	int32 NumEntries = Entries.Num();
+	Ar << Magic;
+	Ar << Version;
+	Ar << Dimension;
+	Ar << ModelIdentity;
+	Ar << NumEntries;
+	for (const FEntry& Entry : Entries)
+	{
+		Ar << const_cast<FString&>(Entry.Scope);
+		Ar << const_cast<TArray<float>&>(Entry.Vector);
+		Ar << const_cast<FString&>(Entry.Response);
+	}
+
+	if (!FFileHelper::SaveArrayToFile(Ar, *FilePath))
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to save semantic cache to %s"), *FilePath);
+		return false;
+	}
+	return true;
+}
+
+bool ULlamaCppSemanticCache::LoadFromFile(const FString& FilePath)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *FilePath))
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: No semantic cache at %s"), *FilePath);
+		return false;
+	}
+
+	if (!Embedder || !Embedder->IsModelLoaded())
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Cannot load semantic cache without a loaded embedder"));
+		return false;
+	}
+
+	FMemoryReader Ar(Data);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	int32 Dimension = 0;
+	uint64 ModelIdentity = 0;
+	int32 NumEntries = 0;
+	Ar << Magic;
+	Ar << Version;
+	Ar << Dimension;
+	Ar << ModelIdentity;
+	Ar << NumEntries;
+	if (Ar.IsError() || Magic != SemanticCacheMagic || Version != SemanticCacheVersion)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: %s is not a semantic cache file"), *FilePath);
+		return false;
+	}
+
+	// The count comes from the file; bound it by what the remaining bytes could hold before reserving
+	if (NumEntries < 0 || NumEntries > (Ar.TotalSize() - Ar.Tell()) / MinEntryBytes)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Semantic cache file %s is corrupt"), *FilePath);
+		return false;
+	}
+
+	if (Dimension != Embedder->GetEmbeddingSize() || ModelIdentity != Embedder->GetModelIdentity())
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Semantic cache %s was built with a different embedding model"), *FilePath);
+		return false;
+	}
+
+	FScopeLock Lock(&CacheLock);
+	Entries.Empty(NumEntries);
+	SizeBytes = 0;
+	bool bValid = true;
+	for (int32 i = 0; i < NumEntries && !Ar.IsError(); ++i)
+	{
+		FEntry& Entry = Entries.AddDefaulted_GetRef();
+		Ar << Entry.Scope;
+		Ar << Entry.Vector;
+		Ar << Entry.Response;
+		if (Entry.Vector.Num() != Dimension)
+		{
+			bValid = false;
+			break;
+		}
+		// Preserve file order as LRU order
+		Entry.LastUsed = ++UseCounter;
+		SizeBytes += Entry.GetSizeBytes();
+	}
+
+	if (Ar.IsError() || !bValid)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Semantic cache file %s is truncated or corrupt"), *FilePath);
+		Entries.Empty();
+		SizeBytes = 0;
+		return false;
+	}
+
+	EvictToFit();
+	UE_LOG(LogLlamaCpp, Log, TEXT("LlamaCpp: Loaded %d semantic cache entries from %s"), Entries.Num(), *FilePath);
+	return true;
+}
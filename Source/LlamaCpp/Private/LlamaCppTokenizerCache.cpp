@@ -0,0 +1,79 @@
+#include "LlamaCppTokenizerCache.h"
+#include "Hash/CityHash.h"
+#include <string>
+
+bool FLlamaTokenizerCache::Tokenize(const llama_vocab* Vocab, const FString& Text, bool bAddSpecial, TArray<llama_token>& OutTokens)
+{
+	const uint64 Key = CityHash64WithSeed(reinterpret_cast<const char*>(*Text), Text.Len() * sizeof(TCHAR), bAddSpecial ? 1 : 0);
+
+	{
+		FScopeLock Lock(&CacheLock);
+		FEntry* Entry = Entries.Find(Key);
+		if (Entry && Entry->bAddSpecial == bAddSpecial && Entry->Text.Equals(Text, ESearchCase::CaseSensitive))
+		{
+			Entry->LastUsed = ++UseCounter;
+			OutTokens = Entry->Tokens;
+			return true;
+		}
+	}
+
+	// Tokenize outside the lock; llama_tokenize only reads the vocab
+	const std::string Utf8 = TCHAR_TO_UTF8(*Text);
+	int32_t NTokens = -llama_tokenize(Vocab, Utf8.c_str(), Utf8.size(), nullptr, 0, bAddSpecial, true);
+	if (NTokens < 0)
+	{
+		return false;
+	}
+	OutTokens.SetNum(NTokens);
+	if (NTokens > 0)
+	{
+		llama_tokenize(Vocab, Utf8.c_str(), Utf8.size(), OutTokens.GetData(), OutTokens.Num(), bAddSpecial, true);
+	}
+
+	FScopeLock Lock(&CacheLock);
+	if (FEntry* Existing = Entries.Find(Key))
+	{
+		SizeBytes -= Existing->GetSizeBytes();
+	}
+	FEntry& Entry = Entries.Add(Key);
+	Entry.Text = Text;
+	Entry.bAddSpecial = bAddSpecial;
+	Entry.Tokens = OutTokens;
+	Entry.LastUsed = ++UseCounter;
+	SizeBytes += Entry.GetSizeBytes();
+
+	EvictToFit();
+	return true;
+}
+
+void FLlamaTokenizerCache::SetMaxBytes(int64 InMaxBytes)
+{
+	FScopeLock Lock(&CacheLock);
+	MaxBytes = InMaxBytes;
+	EvictToFit();
+}
+
+void FLlamaTokenizerCache::Empty()
+{
+	FScopeLock Lock(&CacheLock);
+	Entries.Empty();
+	SizeBytes = 0;
+}
+
+void FLlamaTokenizerCache::EvictToFit()
+{
+	while (Entries.Num() > 0 && SizeBytes > MaxBytes)
+	{
+		const TPair<uint64, FEntry>* Oldest = nullptr;
+		for (const TPair<uint64, FEntry>& Pair : Entries)
+		{
+			if (!Oldest || Pair.Value.LastUsed < Oldest->Value.LastUsed)
+			{
+				Oldest = &Pair;
+			}
+		}
+		const uint64 OldestKey = Oldest->Key;
+		SizeBytes -= Oldest->Value.GetSizeBytes();
+		Entries.Remove(OldestKey);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "llama.h"
+
+/**
+ * LRU cache of tokenized text fragments (system prompts, lore chunks, history turns) so prompt
+ * builders can count and assemble tokens repeatedly without re-running the tokenizer. Bounded by
+ * bytes. Thread-safe.
+ */
+class FLlamaTokenizerCache
+{
+public:
+	/** Tokens for Text, tokenized with Vocab on a miss. Returns false if tokenization failed. */
+	bool Tokenize(const llama_vocab* Vocab, const FString& Text, bool bAddSpecial, TArray<llama_token>& OutTokens);
+
+	void SetMaxBytes(int64 InMaxBytes);
+	void Empty();
+
+private:
+	struct FEntry
+	{
+		// Kept to rule out hash collisions
+		FString Text;
+		bool bAddSpecial = false;
+		TArray<llama_token> Tokens;
+		uint64 LastUsed = 0;
+
+		int64 GetSizeBytes() const
+		{
+			return sizeof(FEntry) + Text.GetAllocatedSize() + Tokens.Num() * sizeof(llama_token);
+		}
+	};
+
+	TMap<uint64, FEntry> Entries;
+	int64 SizeBytes = 0;
+	int64 MaxBytes = 1024 * 1024;
+	uint64 UseCounter = 0;
+
+	FCriticalSection CacheLock;
+
+	void EvictToFit();
+};
@@ -0,0 +1,656 @@
+#include "LlamaCppVectorStore.h"
+#include "Async/MappedFileHandle.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Math/VectorRegister.h"
+#include "Misc/EngineVersionComparison.h"
+#include "LlamaCppLog.h"
+
+namespace
+{
+	constexpr uint32 VectorStoreMagic = 0x3153564C; // "LVS1"
+	constexpr uint32 VectorStoreVersion = 1;
+	constexpr int64 SectionAlignment = 64;
+
+	struct FVectorStoreFileHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		int32 Dimension;
+		int32 Stride;
+		int32 Count;
+		int32 bQuantized;
+		int32 NumLists;
+		int32 Reserved;
+		int64 VectorOffset;
+		int64 ScaleOffset;
+		int64 CentroidOffset;
+		int64 ListOffsetsOffset;
+		int64 ListMembersOffset;
+		int64 TextOffset;
+	};
+
+	/** Rows are padded to a multiple of 8 floats so the kernel can run two 4-wide accumulators without a tail. */
+	int32 StrideFor(int32 Dimension)
+	{
+		return Align(Dimension, 8);
+	}
+
+	/** A and B must be 16-byte aligned with Stride % 8 == 0. Uses SSE on x64 and NEON on arm64 via VectorRegister. */
+	float DotFloat(const float* A, const float* B, int32 Stride)
+	{
+		VectorRegister4Float Acc0 = VectorZeroFloat();
+		VectorRegister4Float Acc1 = VectorZeroFloat();
+		for (int32 i = 0; i < Stride; i += 8)
+		{
+			Acc0 = VectorMultiplyAdd(VectorLoadAligned(A + i), VectorLoadAligned(B + i), Acc0);
+			Acc1 = VectorMultiplyAdd(VectorLoadAligned(A + i + 4), VectorLoadAligned(B + i + 4), Acc1);
+		}
+		alignas(16) float Lanes[4];
+		VectorStoreAligned(VectorAdd(Acc0, Acc1), Lanes);
+		return (Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3]);
+	}
+
+	/** Plain int32 accumulation; compilers vectorize this loop to pmaddwd/sdot. */
+	int32 DotInt8(const int8* RESTRICT A, const int8* RESTRICT B, int32 Stride)
+	{
+		int32 Sum = 0;
+		for (int32 i = 0; i < Stride; ++i)
+		{
+			Sum += static_cast<int32>(A[i]) * static_cast<int32>(B[i]);
+		}
+		return Sum;
+	}
+
+	/** Symmetric per-row quantization. Returns the scale that maps int8 back to float. */
+	float QuantizeRow(const float* In, int32 Num, int8* Out)
+	{
+		float MaxAbs = 0.0f;
+		for (int32 i = 0; i < Num; ++i)
+		{
+			MaxAbs = FMath::Max(MaxAbs, FMath::Abs(In[i]));
+		}
+		const float Scale = MaxAbs > 0.0f ? MaxAbs / 127.0f : 1.0f;
+		const float InvScale = 1.0f / Scale;
+		for (int32 i = 0; i < Num; ++i)
+		{
+			Out[i] = static_cast<int8>(FMath::Clamp(FMath::RoundToInt(In[i] * InvScale), -127, 127));
+		}
+		return Scale;
+	}
+
+	void PushTopK(TArray<TPair<float, int32>>& Heap, int32 K, float Score, int32 Row)
+	{
+		auto Pred = [](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; };
+		if (Heap.Num() < K)
+		{
+			Heap.HeapPush(TPair<float, int32>(Score, Row), Pred);
+		}
+		else if (Score > Heap.HeapTop().Key)
+		{
+			Heap.HeapPopDiscard(Pred);
+			Heap.HeapPush(TPair<float, int32>(Score, Row), Pred);
+		}
+	}
+
+	void PadToSection(FArchive& Ar)
+	{
+		static uint8 Zeros[SectionAlignment] = {};
+		Ar.Serialize(Zeros, Align(Ar.Tell(), SectionAlignment) - Ar.Tell());
+	}
+
+	/** Sizes are 64-bit throughout; a large store's vector section alone can pass 2 GB. */
+	template<typename T>
+	void WriteSection(FArchive& Ar, const T* Data, int64 Num, int64& OutOffset)
+	{
+		PadToSection(Ar);
+		OutOffset = Ar.Tell();
+		Ar.Serialize(const_cast<T*>(Data), Num * static_cast<int64>(sizeof(T)));
+	}
+}
+
+void ULlamaCppVectorStore::BeginDestroy()
+{
+	ReleaseMapping();
+	Super::BeginDestroy();
+}
+
+void ULlamaCppVectorStore::Initialize(int32 InDimension, bool bInQuantizeInt8)
+{
+	FRWScopeLock Lock(StoreLock, SLT_Write);
+	ResetLocked(InDimension, bInQuantizeInt8);
+}
+
+void ULlamaCppVectorStore::ResetLocked(int32 InDimension, bool bInQuantizeInt8)
+{
+	ReleaseMapping();
+	Dimension = FMath::Max(InDimension, 0);
+	Stride = StrideFor(Dimension);
+	bQuantizeInt8 = bInQuantizeInt8;
+	Count = 0;
+	FloatStorage.Empty();
+	Int8Storage.Empty();
+	ScaleStorage.Empty();
+	Texts.Empty();
+	NumLists = 0;
+	Centroids.Empty();
+	ListOffsets.Empty();
+	ListMembers.Empty();
+	RefreshViews();
+}
+
+int32 ULlamaCppVectorStore::Add(const FLlamaEmbedding& Embedding, const FString& Text)
+{
+	return AddVector(Embedding.Vector, Text);
+}
+
+int32 ULlamaCppVectorStore::AddVector(TArrayView<const float> Vector, const FString& Text)
+{
+	FRWScopeLock Lock(StoreLock, SLT_Write);
+
+	// Under the lock, so concurrent first adds agree on the dimension
+	if (Dimension == 0 && Vector.Num() > 0)
+	{
+		ResetLocked(Vector.Num(), bQuantizeInt8);
+	}
+
+	if (Vector.Num() != Dimension)
+	{
+		UE_LOG(LogLlamaCpp, Warning, TEXT("LlamaCpp: Vector store expects %d dimensions, got %d"), Dimension, Vector.Num());
+		return INDEX_NONE;
+	}
+
+	DetachFromMapping();
+
+	if (bQuantizeInt8)
+	{
+		Int8Storage.AddZeroed(Stride);
+		ScaleStorage.Add(QuantizeRow(Vector.GetData(), Dimension, Int8Storage.GetData() + Count * Stride));
+	}
+	else
+	{
+		FloatStorage.AddZeroed(Stride);
+		FMemory::Memcpy(FloatStorage.GetData() + Count * Stride, Vector.GetData(), Dimension * sizeof(float));
+	}
+	Texts.Add(Text);
+
+	// New rows are not in any inverted list, fall back to flat search until the index is rebuilt
+	if (NumLists > 0)
+	{
+		NumLists = 0;
+		Centroids.Empty();
+		ListOffsets.Empty();
+		ListMembers.Empty();
+	}
+
+	RefreshViews();
+	return Count++;
+}
+
+void ULlamaCppVectorStore::Empty()
+{
+	FRWScopeLock Lock(StoreLock, SLT_Write);
+	ResetLocked(Dimension, bQuantizeInt8);
+}
+
+int32 ULlamaCppVectorStore::Num() const
+{
+	return Count;
+}
+
+void ULlamaCppVectorStore::ScoreRow(int32 Row, const float* QueryF, const int8* QueryQ, float QueryScale, TArray<TPair<float, int32>>& Heap, int32 K) const
+{
+	const float Score = bQuantizeInt8
+		? static_cast<float>(DotInt8(QueryQ, Int8Data + static_cast<int64>(Row) * Stride, Stride)) * QueryScale * Scales[Row]
+		: DotFloat(QueryF, FloatData + static_cast<int64>(Row) * Stride, Stride);
+	PushTopK(Heap, K, Score, Row);
+}
+
+TArray<FLlamaVectorSearchResult> ULlamaCppVectorStore::Search(const FLlamaEmbedding& Query, int32 K) const
+{
+	return SearchVector(Query.Vector, K);
+}
+
+TArray<FLlamaVectorSearchResult> ULlamaCppVectorStore::SearchVector(TArrayView<const float> Query, int32 K) const
+{
+	FRWScopeLock Lock(StoreLock, SLT_ReadOnly);
+
+	TArray<FLlamaVectorSearchResult> Results;
+	if (Count == 0 || K <= 0 || Query.Num() != Dimension)
+	{
+		return Results;
+	}
+
+	// Pad and align the query to the row stride once
+	TArray<float, TAlignedHeapAllocator<64>> QueryF;
+	QueryF.SetNumZeroed(Stride);
+	FMemory::Memcpy(QueryF.GetData(), Query.GetData(), Dimension * sizeof(float));
+
+	TArray<int8, TAlignedHeapAllocator<64>> QueryQ;
+	float QueryScale = 1.0f;
+	if (bQuantizeInt8)
+	{
+		QueryQ.SetNumZeroed(Stride);
+		QueryScale = QuantizeRow(QueryF.GetData(), Dimension, QueryQ.GetData());
+	}
+
+	TArray<TPair<float, int32>> Heap;
+	Heap.Reserve(K + 1);
+
+	if (NumLists > 0)
+	{
+		// Rank clusters by centroid similarity, then scan the closest NumProbes lists
+		TArray<TPair<float, int32>> ListHeap;
+		const int32 Probes = FMath::Clamp(NumProbes, 1, NumLists);
+		for (int32 l = 0; l < NumLists; ++l)
+		{
+			PushTopK(ListHeap, Probes, DotFloat(QueryF.GetData(), Centroids.GetData() + l * Stride, Stride), l);
+		}
+		for (const TPair<float, int32>& List : ListHeap)
+		{
+			for (int32 m = ListOffsets[List.Value]; m < ListOffsets[List.Value + 1]; ++m)
+			{
+				ScoreRow(ListMembers[m], QueryF.GetData(), QueryQ.GetData(), QueryScale, Heap, K);
+			}
+		}
+	}
+	else
+	{
+		for (int32 Row = 0; Row < Count; ++Row)
+		{
+			ScoreRow(Row, QueryF.GetData(), QueryQ.GetData(), QueryScale, Heap, K);
+		}
+	}
+
+	Heap.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key > B.Key; });
+	Results.Reserve(Heap.Num());
+	for (const TPair<float, int32>& Entry : Heap)
+	{
+		FLlamaVectorSearchResult& Result = Results.AddDefaulted_GetRef();
+		Result.Index = Entry.Value;
+		Result.Score = Entry.Key;
+		Result.Text = Texts[Entry.Value];
+	}
+	return Results;
+}
+
+void ULlamaCppVectorStore::BuildIvfIndex(int32 InNumLists, int32 Iterations)
+{
+	FRWScopeLock Lock(StoreLock, SLT_Write);
+
+	if (Count == 0)
+	{
+		return;
+	}
+
+	const int32 Lists = FMath::Clamp(InNumLists > 0 ? InNumLists : FMath::RoundToInt(FMath::Sqrt(static_cast<float>(Count))), 1, Count);
+
+	// Dequantized copy of a row, padded to Stride
+	auto ReadRow = [this](int32 Row, float* Out)
+	{
+		if (bQuantizeInt8)
+		{
+			const int8* Src = Int8Data + static_cast<int64>(Row) * Stride;
+			for (int32 i = 0; i < Stride; ++i)
+			{
+				Out[i] = Src[i] * Scales[Row];
+			}
+		}
+		else
+		{
+			FMemory::Memcpy(Out, FloatData + static_cast<int64>(Row) * Stride, Stride * sizeof(float));
+		}
+	};
+
+	// Train on an evenly spaced sample so clustering stays cheap for large stores
+	const int32 SampleCount = FMath::Min(Count, Lists * 64);
+	TArray<float, TAlignedHeapAllocator<64>> Sample;
+	Sample.SetNumZeroed(SampleCount * Stride);
+	for (int32 s = 0; s < SampleCount; ++s)
+	{
+		ReadRow(static_cast<int32>(static_cast<int64>(s) * Count / SampleCount), Sample.GetData() + s * Stride);
+	}
+
+	Centroids.SetNumZeroed(Lists * Stride);
+	for (int32 l = 0; l < Lists; ++l)
+	{
+		FMemory::Memcpy(Centroids.GetData() + l * Stride, Sample.GetData() + (static_cast<int64>(l) * SampleCount / Lists) * Stride, Stride * sizeof(float));
+	}
+
+	auto Nearest = [this, Lists](const float* Vec)
+	{
+		int32 Best = 0;
+		float BestScore = -MAX_flt;
+		for (int32 l = 0; l < Lists; ++l)
+		{
+			const float Score = DotFloat(Vec, Centroids.GetData() + l * Stride, Stride);
+			if (Score > BestScore)
+			{
+				BestScore = Score;
+				Best = l;
+			}
+		}
+		return Best;
+	};
+
+	TArray<int32> Assignment;
+	Assignment.SetNumZeroed(SampleCount);
+	for (int32 Iter = 0; Iter < Iterations; ++Iter)
+	{
+		ParallelFor(SampleCount, [&](int32 s)
+		{
+			Assignment[s] = Nearest(Sample.GetData() + s * Stride);
+		});
+
+		// Spherical k-means: centroid is the renormalized sum of its members
+		TArray<double> Sums;
+		Sums.SetNumZeroed(Lists * Stride);
+		for (int32 s = 0; s < SampleCount; ++s)
+		{
+			const float* Vec = Sample.GetData() + s * Stride;
+			double* Sum = Sums.GetData() + Assignment[s] * Stride;
+			for (int32 i = 0; i < Dimension; ++i)
+			{
+				Sum[i] += Vec[i];
+			}
+		}
+		for (int32 l = 0; l < Lists; ++l)
+		{
+			const double* Sum = Sums.GetData() + l * Stride;
+			double Norm = 0.0;
+			for (int32 i = 0; i < Dimension; ++i)
+			{
+				Norm += Sum[i] * Sum[i];
+			}
+			if (Norm <= 0.0)
+			{
+				continue; // empty cluster keeps its previous centroid
+			}
+			const double InvNorm = 1.0 / FMath::Sqrt(Norm);
+			float* Centroid = Centroids.GetData() + l * Stride;
+			for (int32 i = 0; i < Dimension; ++i)
+			{
+				Centroid[i] = static_cast<float>(Sum[i] * InvNorm);
+			}
+		}
+	}
+
+	// Assign every row and lay the lists out contiguously
+	TArray<int32> RowList;
+	RowList.SetNumUninitialized(Count);
+	ParallelFor(Count, [&](int32 Row)
+	{
+		alignas(16) float RowBuffer[1024];
+		TArray<float, TAlignedHeapAllocator<64>> Heap;
+		float* Vec = RowBuffer;
+		if (Stride > static_cast<int32>(UE_ARRAY_COUNT(RowBuffer)))
+		{
+			Heap.SetNumUninitialized(Stride);
+			Vec = Heap.GetData();
+		}
+		ReadRow(Row, Vec);
+		RowList[Row] = Nearest(Vec);
+	});
+
+	ListOffsets.SetNumZeroed(Lists + 1);
+	for (int32 Row = 0; Row < Count; ++Row)
+	{
+		++ListOffsets[RowList[Row] + 1];
+	}
+	for (int32 l = 0; l < Lists; ++l)
+	{
+		ListOffsets[l + 1] += ListOffsets[l];
+	}
+	TArray<int32> Cursor(ListOffsets.GetData(), Lists);
+	ListMembers.SetNumUninitialized(Count);
+	for (int32 Row = 0; Row < Count; ++Row)
+	{
+		ListMembers[Cursor[RowList[Row]]++] = Row;
+	}
+
+	NumLists = Lists;
+	UE_LOG(LogLlamaCpp, Log, TEXT("LlamaCpp: Built IVF index with %d lists over %d vectors"), NumLists, Count);
+}
+
+FString ULlamaCppVectorStore::BuildAugmentedPrompt(const FLlamaEmbedding& Query, const FString& PromptTemplate, int32 K, const FString& Separator)
+{
+	TArray<FString> Chunks;
+	for (const FLlamaVectorSearchResult& Result : Search(Query, K))
+	{
+		Chunks.Add(Result.Text);
+	}
+	return PromptTemplate.Replace(TEXT("{context}"), *FString::Join(Chunks, *Separator));
+}
+
+bool ULlamaCppVectorStore::SaveToFile(const FString& FilePath) const
+{
+	FRWScopeLock Lock(StoreLock, SLT_ReadOnly);
+
+	FVectorStoreFileHeader Header;
+	FMemory::Memzero(Header);
+	Header.Magic = VectorStoreMagic;
+	Header.Version = VectorStoreVersion;
+	Header.Dimension = Dimension;
+	Header.Stride = Stride;
+	Header.Count = Count;
+	Header.bQuantized = bQuantizeInt8 ? 1 : 0;
+	Header.NumLists = NumLists;
+
+	// Stream straight to disk; the sections are written first and the header, now holding their offsets, last
+	TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileWriter(*FilePath));
+	if (!Ar)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to write vector store to %s"), *FilePath);
+		return false;
+	}
+	Ar->Serialize(&Header, sizeof(Header));
+
+	if (bQuantizeInt8)
+	{
+		WriteSection(*Ar, Int8Data, static_cast<int64>(Count) * Stride, Header.VectorOffset);
+		WriteSection(*Ar, Scales, Count, Header.ScaleOffset);
+	}
+	else
+	{
+		WriteSection(*Ar, FloatData, static_cast<int64>(Count) * Stride, Header.VectorOffset);
+	}
+
+	if (NumLists > 0)
+	{
+		WriteSection(*Ar, Centroids.GetData(), Centroids.Num(), Header.CentroidOffset);
+		WriteSection(*Ar, ListOffsets.GetData(), ListOffsets.Num(), Header.ListOffsetsOffset);
+		WriteSection(*Ar, ListMembers.GetData(), ListMembers.Num(), Header.ListMembersOffset);
+	}
+
+	// Texts: int32 byte length followed by UTF-8 bytes
+	PadToSection(*Ar);
+	Header.TextOffset = Ar->Tell();
+	for (const FString& Text : Texts)
+	{
+		FTCHARToUTF8 Utf8(*Text);
+		int32 Len = Utf8.Length();
+		Ar->Serialize(&Len, sizeof(Len));
+		Ar->Serialize(const_cast<void*>(static_cast<const void*>(Utf8.Get())), Len);
+	}
+
+	Ar->Seek(0);
+	Ar->Serialize(&Header, sizeof(Header));
+
+	if (!Ar->Close())
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to write vector store to %s"), *FilePath);
+		return false;
+	}
+	return true;
+}
+
+bool ULlamaCppVectorStore::LoadFromFile(const FString& FilePath)
+{
+	FRWScopeLock Lock(StoreLock, SLT_Write);
+
+	// Loading replaces the current contents, even if it fails
+	ReleaseMapping();
+	Count = 0;
+	FloatStorage.Empty();
+	Int8Storage.Empty();
+	ScaleStorage.Empty();
+	Texts.Empty();
+	NumLists = 0;
+	Centroids.Empty();
+	ListOffsets.Empty();
+	ListMembers.Empty();
+	RefreshViews();
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+#if UE_VERSION_OLDER_THAN(5, 3, 0)
+	MappedHandle = PlatformFile.OpenMapped(*FilePath);
+#else
+	FOpenMappedResult OpenResult = PlatformFile.OpenMappedEx(*FilePath);
+	MappedHandle = OpenResult.HasValue() ? OpenResult.StealValue().Release() : nullptr;
+#endif
+	if (!MappedHandle)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to map vector store %s"), *FilePath);
+		return false;
+	}
+
+	const int64 FileSize = MappedHandle->GetFileSize();
+	MappedRegion = FileSize >= static_cast<int64>(sizeof(FVectorStoreFileHeader)) ? MappedHandle->MapRegion(0, FileSize) : nullptr;
+	if (!MappedRegion)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: Failed to map vector store region %s"), *FilePath);
+		ReleaseMapping();
+		return false;
+	}
+
+	const uint8* Base = MappedRegion->GetMappedPtr();
+	FVectorStoreFileHeader Header;
+	FMemory::Memcpy(&Header, Base, sizeof(Header));
+
+	// Every section must lie inside the mapping; offsets and sizes come straight from the file
+	auto SectionFits = [FileSize](int64 Offset, int64 Bytes)
+	{
+		return Offset >= 0 && Bytes >= 0 && Offset <= FileSize && Bytes <= FileSize - Offset;
+	};
+
+	const int64 ElementSize = Header.bQuantized ? sizeof(int8) : sizeof(float);
+	bool bValid = Header.Magic == VectorStoreMagic && Header.Version == VectorStoreVersion
+		&& Header.Dimension > 0 && Header.Stride == StrideFor(Header.Dimension) && Header.Count >= 0
+		&& Header.NumLists >= 0 && Header.NumLists <= Header.Count
+		&& Header.VectorOffset % SectionAlignment == 0
+		&& SectionFits(Header.VectorOffset, static_cast<int64>(Header.Count) * Header.Stride * ElementSize)
+		&& (!Header.bQuantized || SectionFits(Header.ScaleOffset, static_cast<int64>(Header.Count) * sizeof(float)))
+		&& SectionFits(Header.TextOffset, 0);
+
+	if (bValid && Header.NumLists > 0)
+	{
+		bValid = SectionFits(Header.CentroidOffset, static_cast<int64>(Header.NumLists) * Header.Stride * sizeof(float))
+			&& SectionFits(Header.ListOffsetsOffset, (static_cast<int64>(Header.NumLists) + 1) * sizeof(int32))
+			&& SectionFits(Header.ListMembersOffset, static_cast<int64>(Header.Count) * sizeof(int32));
+	}
+
+	if (bValid && Header.NumLists > 0)
+	{
+		// Lists must partition [0, Count): offsets non-decreasing from 0 to Count, members in range
+		const int32* Offsets = reinterpret_cast<const int32*>(Base + Header.ListOffsetsOffset);
+		const int32* Members = reinterpret_cast<const int32*>(Base + Header.ListMembersOffset);
+		bValid = Offsets[0] == 0 && Offsets[Header.NumLists] == Header.Count;
+		for (int32 l = 0; bValid && l < Header.NumLists; ++l)
+		{
+			bValid = Offsets[l] <= Offsets[l + 1];
+		}
+		for (int32 i = 0; bValid && i < Header.Count; ++i)
+		{
+			bValid = Members[i] >= 0 && Members[i] < Header.Count;
+		}
+	}
+
+	if (!bValid)
+	{
+		UE_LOG(LogLlamaCpp, Error, TEXT("LlamaCpp: %s is not a valid vector store file"), *FilePath);
+		ReleaseMapping();
+		return false;
+	}
+
+	Dimension = Header.Dimension;
+	Stride = Header.Stride;
+	Count = Header.Count;
+	bQuantizeInt8 = Header.bQuantized != 0;
+
+	// Vectors are used in place; IVF lists and texts are small enough to copy out
+	FloatData = bQuantizeInt8 ? nullptr : reinterpret_cast<const float*>(Base + Header.VectorOffset);
+	Int8Data = bQuantizeInt8 ? reinterpret_cast<const int8*>(Base + Header.VectorOffset) : nullptr;
+	Scales = bQuantizeInt8 ? reinterpret_cast<const float*>(Base + Header.ScaleOffset) : nullptr;
+
+	NumLists = Header.NumLists;
+	if (NumLists > 0)
+	{
+		Centroids.Append(reinterpret_cast<const float*>(Base + Header.CentroidOffset), NumLists * Stride);
+		ListOffsets.Append(reinterpret_cast<const int32*>(Base + Header.ListOffsetsOffset), NumLists + 1);
+		ListMembers.Append(reinterpret_cast<const int32*>(Base + Header.ListMembersOffset), Count);
+	}
+
+	Texts.Empty(Count);
+	const uint8* TextPtr = Base + Header.TextOffset;
+	const uint8* End = Base + FileSize;
+	for (int32 i = 0; i < Count; ++i)
+	{
+		int32 Len = 0;
+		if (TextPtr + sizeof(Len) > End)
+		{
+			break;
+		}
+		FMemory::Memcpy(&Len, TextPtr, sizeof(Len));
+		TextPtr += sizeof(Len);
+		Len = FMath::Clamp(Len, 0, static_cast<int32>(End - TextPtr));
+		FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(TextPtr), Len);
+		Texts.Emplace(Converted.Length(), Converted.Get());
+		TextPtr += Len;
+	}
+	Texts.SetNum(Count);
+
+	UE_LOG(LogLlamaCpp, Log, TEXT("LlamaCpp: Mapped vector store %s (%d vectors, dim=%d, int8=%d, lists=%d)"),
+		*FilePath, Count, Dimension, bQuantizeInt8 ? 1 : 0, NumLists);
+	return true;
+}
+
+void ULlamaCppVectorStore::ReleaseMapping()
+{
+	// Region must be released before its handle
+	delete MappedRegion;
+	MappedRegion = nullptr;
+	delete MappedHandle;
+	MappedHandle = nullptr;
+	RefreshViews();
+}
+
+void ULlamaCppVectorStore::DetachFromMapping()
+{
+	if (!MappedRegion)
+	{
+		return;
+	}
+
+	if (bQuantizeInt8)
+	{
+		Int8Storage.Append(Int8Data, Count * Stride);
+		ScaleStorage.Append(Scales, Count);
+	}
+	else
+	{
+		FloatStorage.Append(FloatData, Count * Stride);
+	}
+	ReleaseMapping();
+}
+
+void ULlamaCppVectorStore::RefreshViews()
+{
+	if (MappedRegion)
+	{
+		return;
+	}
+	FloatData = FloatStorage.GetData();
+	Int8Data = Int8Storage.GetData();
+	Scales = ScaleStorage.GetData();
+}
@@ -1,6 +1,7 @@
 #include "SherpaOnnxTextToSpeech.h"
 #include "Async/Async.h"
 
+#include "LlamaCppAudioResampler.h"
 #include "LlamaCppLog.h"
 
 #if WITH_SHERPA_ONNX
@@ -120,8 +121,9 @@ void USherpaOnnxTextToSpeech::Speak(const FString& Text, int32 SpeakerId, float
 	TWeakObjectPtr<USherpaOnnxTextToSpeech> WeakThis(this);
 	SherpaOnnxOfflineTts* BgTts = TtsEngine;
 	FString TextCopy = Text;
+	const int32 TargetSampleRate = OutputSampleRate;
 
-	Async(EAsyncExecution::Thread, [WeakThis, BgTts, TextCopy, SpeakerId, Speed]()
+	Async(EAsyncExecution::Thread, [WeakThis, BgTts, TextCopy, SpeakerId, Speed, TargetSampleRate]()
 	{
 		std::string TextUtf8 = TCHAR_TO_UTF8(*TextCopy);
 
@@ -150,6 +152,16 @@ void USherpaOnnxTextToSpeech::Speak(const FString& Text, int32 SpeakerId, float
 
 		int32 SampleRate = Audio->sample_rate;
 		int32 NumSamples = Audio->n;
+		const float* Samples = Audio->samples;
+
+		TArray<float> Resampled;
+		if (TargetSampleRate > 0 && TargetSampleRate != SampleRate)
+		{
+			FLlamaAudioResampler::Convert(Samples, NumSamples, SampleRate, 1, TargetSampleRate, Resampled);
+			Samples = Resampled.GetData();
+			NumSamples = Resampled.Num();
+			SampleRate = TargetSampleRate;
+		}
 
 		// Copy PCM data (float samples)
 		TArray<uint8> PcmBytes;
@@ -158,7 +170,7 @@ void USherpaOnnxTextToSpeech::Speak(const FString& Text, int32 SpeakerId, float
 
 		for (int32 i = 0; i < NumSamples; ++i)
 		{
-			float Sample = FMath::Clamp(Audio->samples[i], -1.0f, 1.0f);
+			float Sample = FMath::Clamp(Samples[i], -1.0f, 1.0f);
 			PcmData[i] = static_cast<int16>(Sample * 32767.0f);
 		}
 
@@ -1,6 +1,7 @@
 #include "SherpaOnnxTranscription.h"
 #include "Async/Async.h"
 #include "Misc/Paths.h"
+#include "LlamaCppAudioResampler.h"
 #include "LlamaCppLog.h"
 
 #if WITH_SHERPA_ONNX
@@ -14,6 +15,7 @@ THIRD_PARTY_INCLUDES_END
 USherpaOnnxTranscription::USherpaOnnxTranscription()
 {
 	StreamingDoneEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	CaptureResampler = MakeShared<FLlamaAudioResampler, ESPMode::ThreadSafe>();
 }
 
 void USherpaOnnxTranscription::BeginDestroy()
@@ -160,6 +162,12 @@ void USherpaOnnxTranscription::SherpaOnnxStartStreaming()
 		return;
 	}
 
+	{
+		FScopeLock Lock(&AudioBufferLock);
+		AudioBuffer.Reset();
+		CaptureResampler->Reset();
+	}
+
 	// Start mic capture
 	if (!AudioCapture)
 	{
@@ -174,24 +182,10 @@ void USherpaOnnxTranscription::SherpaOnnxStartStreaming()
 			return;
 		}
 
-		// Downmix to mono if needed and store
+		// Downmix and resample to the 16kHz the stream is fed at
 		FScopeLock Lock(&AudioBufferLock);
-		if (NumChannels == 1)
-		{
-			AudioBuffer.Append(InAudio, NumFrames);
-		}
-		else
-		{
-			for (int32 i = 0; i < NumFrames; ++i)
-			{
-				float Mono = 0.0f;
-				for (int32 Ch = 0; Ch < NumChannels; ++Ch)
-				{
-					Mono += InAudio[i * NumChannels + Ch];
-				}
-				AudioBuffer.Add(Mono / NumChannels);
-			}
-		}
+		CaptureResampler->Init(SampleRate, NumChannels, 16000);
+		CaptureResampler->Process(InAudio, NumFrames, AudioBuffer);
 	}, 1024))
 	{
 		UE_LOG(LogSherpaOnnxASR, Error, TEXT("SherpaOnnxASR: Failed to open audio capture stream"));
@@ -259,7 +253,7 @@ void USherpaOnnxTranscription::DecodeLoop()
 			}
 		}
 
-		// Feed audio to the stream (sherpa handles resampling internally)
+		// Feed audio to the stream (already 16kHz mono)
 		if (LocalBuffer.Num() > 0 && Stream)
 		{
 			SherpaOnnxOnlineStreamAcceptWaveform(Stream, 16000, LocalBuffer.GetData(), LocalBuffer.Num());
@@ -0,0 +1,93 @@
+#include "WhisperAudioRingBuffer.h"
+
+void FWhisperAudioRingBuffer::Reset(int32 CapacitySamples, int32 InFrameSize)
+{
+	FrameSize = FMath::Max(InFrameSize, 1);
+	const int32 Capacity = FMath::DivideAndRoundUp(FMath::Max(CapacitySamples, FrameSize), FrameSize) * FrameSize;
+	if (Buffer.Num() != Capacity)
+	{
+		Buffer.Empty(Capacity);
+		Buffer.SetNumZeroed(Capacity);
+	}
+
+	WriteReserve = 0;
+	WriteCommit = 0;
+	DroppedSamples = 0;
+	DeviceOverflows = 0;
+}
+
+void FWhisperAudioRingBuffer::Write(const float* Data, int32 NumSamples)
+{
+	const int32 Capacity = Buffer.Num();
+	if (Capacity == 0 || NumSamples <= 0)
+	{
+		return;
+	}
+
+	const int64 Start = WriteCommit.Load();
+	const int64 End = Start + NumSamples;
+	WriteReserve = End;
+	FPlatformMisc::MemoryBarrier();
+
+	const int32 NumToCopy = FMath::Min(NumSamples, Capacity);
+	const float* Src = Data + (NumSamples - NumToCopy);
+	const int32 First = static_cast<int32>((End - NumToCopy) % Capacity);
+	const int32 FirstCount = FMath::Min(NumToCopy, Capacity - First);
+	FMemory::Memcpy(Buffer.GetData() + First, Src, FirstCount * sizeof(float));
+	if (FirstCount < NumToCopy)
+	{
+		FMemory::Memcpy(Buffer.GetData(), Src + FirstCount, (NumToCopy - FirstCount) * sizeof(float));
+	}
+
+	FPlatformMisc::MemoryBarrier();
+	WriteCommit = End;
+}
+
+int32 FWhisperAudioRingBuffer::Read(int64& Cursor, TArray<float>& Out)
+{
+	const int32 Capacity = Buffer.Num();
+	const int64 End = WriteCommit.Load();
+	if (Capacity == 0 || Cursor >= End)
+	{
+		Cursor = FMath::Min(Cursor, End);
+		return 0;
+	}
+
+	int64 Begin = Cursor;
+	int64 Lost = 0;
+	if (End - Begin > Capacity)
+	{
+		Lost = End - Capacity - Begin;
+		Begin = End - Capacity;
+	}
+
+	const int32 NumSamples = static_cast<int32>(End - Begin);
+	const int32 OutStart = Out.AddUninitialized(NumSamples);
+	const int32 First = static_cast<int32>(Begin % Capacity);
+	const int32 FirstCount = FMath::Min(NumSamples, Capacity - First);
+	FMemory::Memcpy(Out.GetData() + OutStart, Buffer.GetData() + First, FirstCount * sizeof(float));
+	if (FirstCount < NumSamples)
+	{
+		FMemory::Memcpy(Out.GetData() + OutStart + FirstCount, Buffer.GetData(), (NumSamples - FirstCount) * sizeof(float));
+	}
+
+	// Anything below this may have been overwritten while it was being copied
+	FPlatformMisc::MemoryBarrier();
+	const int64 OldestIntact = WriteReserve.Load() - Capacity;
+	int32 NumTorn = 0;
+	if (OldestIntact > Begin)
+	{
+		NumTorn = static_cast<int32>(FMath::Min<int64>(OldestIntact - Begin, NumSamples));
+		NumTorn = FMath::Min(FMath::DivideAndRoundUp(NumTorn, FrameSize) * FrameSize, NumSamples);
+		Out.RemoveAt(OutStart, NumTorn);
+		Lost += NumTorn;
+	}
+
+	if (Lost > 0)
+	{
+		DroppedSamples += Lost;
+	}
+
+	Cursor = End;
+	return NumSamples - NumTorn;
+}
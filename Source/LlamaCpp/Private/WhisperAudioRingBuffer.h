@@ -0,0 +1,49 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Fixed-capacity ring of interleaved capture samples. One producer (the audio device callback) writes
+ * without locking or allocating; any number of consumers read with their own cursor, a running count
+ * of samples written. When a consumer falls more than a full ring behind, the oldest samples are
+ * skipped and added to the dropped counter instead of blocking the producer.
+ */
+class FWhisperAudioRingBuffer
+{
+public:
+	/** Allocate CapacitySamples (rounded up to whole frames) and rewind all counters. Not safe while the producer runs. */
+	void Reset(int32 CapacitySamples, int32 InFrameSize);
+
+	/** Producer only. Writes larger than the ring keep their newest samples. */
+	void Write(const float* Data, int32 NumSamples);
+
+	/**
+	 * Append everything written since Cursor to Out and move Cursor to the write position. Returns the
+	 * number of samples appended; samples that were overwritten before they could be read are skipped.
+	 */
+	int32 Read(int64& Cursor, TArray<float>& Out);
+
+	/** Running count of samples written; a consumer that wants only new audio starts here. */
+	int64 GetWriteCursor() const { return WriteCommit.Load(); }
+
+	int32 GetCapacity() const { return Buffer.Num(); }
+
+	/** Samples consumers lost because the producer lapped them. */
+	int64 GetDroppedSamples() const { return DroppedSamples.Load(); }
+
+	/** Device callbacks that reported an overflow on the driver side. */
+	int32 GetDeviceOverflows() const { return DeviceOverflows.Load(); }
+	void AddDeviceOverflow() { ++DeviceOverflows; }
+
+private:
+	TArray<float> Buffer;
+	int32 FrameSize = 1;
+
+	// Reserve moves before the producer touches the ring and Commit after, so a reader can tell
+	// which of the samples it copied may have been overwritten underneath it
+	TAtomic<int64> WriteReserve{0};
+	TAtomic<int64> WriteCommit{0};
+
+	TAtomic<int64> DroppedSamples{0};
+	TAtomic<int32> DeviceOverflows{0};
+};
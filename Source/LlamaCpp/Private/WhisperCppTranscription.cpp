@@ -1,7 +1,12 @@
 #include "WhisperCppTranscription.h"
+#include "WhisperAudioRingBuffer.h"
+#include "LlamaCppAudioResampler.h"
+#include "WhisperStatePool.h"
+#include "WhisperWavReader.h"
+#include "WhisperJobQueue.h"
+#include "WhisperMelStream.h"
 #include "Async/Async.h"
 #include "HAL/FileManager.h"
-#include "Misc/FileHelper.h"
 #include "AudioCaptureCore.h"
 #include "whisper.h"
 
@@ -9,27 +14,287 @@
 #include <vector>
 #include "LlamaCppLog.h"
 
+namespace
+{
+	whisper_vad_params MakeVadParams(float Threshold, int32 MinSilenceMs)
+	{
+		whisper_vad_params Params = whisper_vad_default_params();
+		Params.threshold = FMath::Clamp(Threshold, 0.0f, 1.0f);
+		Params.min_silence_duration_ms = FMath::Max(MinSilenceMs, 0);
+		return Params;
+	}
+
+	/** How far the encoder's context is shortened for clips under WHISPER_CHUNK_SIZE seconds. */
+	struct FAudioCtxPolicy
+	{
+		bool bEnabled = false;
+		float MarginSeconds = 1.0f;
+		float MinSeconds = 3.0f;
+
+		/**
+		 * audio_ctx for NumSamples of 16kHz audio, or 0 for the model's full 30 s context. The encoder's
+		 * cost grows with its context length, and whisper otherwise pads every clip to 30 s.
+		 */
+		int Apply(whisper_context* Ctx, int32 NumSamples) const
+		{
+			if (!bEnabled)
+			{
+				return 0;
+			}
+
+			const int ModelAudioCtx = whisper_model_n_audio_ctx(Ctx);
+			const float ClipSeconds = static_cast<float>(NumSamples) / WHISPER_SAMPLE_RATE;
+			const float Seconds = FMath::Max(ClipSeconds + MarginSeconds, MinSeconds);
+			if (Seconds >= WHISPER_CHUNK_SIZE)
+			{
+				return 0;
+			}
+			return FMath::Clamp(FMath::CeilToInt(Seconds * ModelAudioCtx / WHISPER_CHUNK_SIZE), 1, ModelAudioCtx);
+		}
+	};
+
+	FAudioCtxPolicy MakeAudioCtxPolicy(bool bEnabled, float MarginSeconds, float MinSeconds)
+	{
+		FAudioCtxPolicy Policy;
+		Policy.bEnabled = bEnabled;
+		Policy.MarginSeconds = FMath::Max(MarginSeconds, 0.0f);
+		Policy.MinSeconds = FMath::Clamp(MinSeconds, 1.0f, static_cast<float>(WHISPER_CHUNK_SIZE));
+		return Policy;
+	}
+
+	/** Sample range from the start of the first to the end of the last speech segment VAD finds in Audio. */
+	bool FindSpeech(whisper_vad_context* Vad, const whisper_vad_params& Params, const TArray<float>& Audio, int32& OutStart, int32& OutEnd)
+	{
+		whisper_vad_segments* Segments = whisper_vad_segments_from_samples(Vad, Params, Audio.GetData(), Audio.Num());
+		if (!Segments)
+		{
+			return false;
+		}
+
+		// Segment times are in centiseconds
+		const int NSegments = whisper_vad_segments_n_segments(Segments);
+		if (NSegments > 0)
+		{
+			const float T0 = whisper_vad_segments_get_segment_t0(Segments, 0);
+			const float T1 = whisper_vad_segments_get_segment_t1(Segments, NSegments - 1);
+			OutStart = FMath::Clamp(static_cast<int32>(T0 * WHISPER_SAMPLE_RATE / 100.0f), 0, Audio.Num());
+			OutEnd = FMath::Clamp(static_cast<int32>(T1 * WHISPER_SAMPLE_RATE / 100.0f), OutStart, Audio.Num());
+		}
+		whisper_vad_free_segments(Segments);
+		return NSegments > 0;
+	}
+
+	FWhisperTranscriptionSegment ReadSegment(whisper_state* State, int Index)
+	{
+		FWhisperTranscriptionSegment Segment;
+		Segment.Text = UTF8_TO_TCHAR(whisper_full_get_segment_text_from_state(State, Index));
+		Segment.StartTimeSeconds = static_cast<float>(whisper_full_get_segment_t0_from_state(State, Index)) / 100.0f;
+		Segment.EndTimeSeconds = static_cast<float>(whisper_full_get_segment_t1_from_state(State, Index)) / 100.0f;
+		return Segment;
+	}
+
+	/** User data for whisper's callbacks during one whisper_full call. Lives on the calling thread's stack. */
+	struct FWhisperCallbackTarget
+	{
+		TWeakObjectPtr<UWhisperCppTranscription> Owner;
+		TSharedRef<TAtomic<bool>, ESPMode::ThreadSafe> CancelFlag;
+	};
+
+	bool IsCancelled(void* UserData)
+	{
+		return *static_cast<const FWhisperCallbackTarget*>(UserData)->CancelFlag;
+	}
+
+	void BroadcastProgress(whisper_context* /*Ctx*/, whisper_state* /*State*/, int Progress, void* UserData)
+	{
+		TWeakObjectPtr<UWhisperCppTranscription> Owner = static_cast<const FWhisperCallbackTarget*>(UserData)->Owner;
+		AsyncTask(ENamedThreads::GameThread, [Owner, Progress]()
+		{
+			if (UWhisperCppTranscription* Self = Owner.Get())
+			{
+				Self->OnTranscriptionProgress.Broadcast(Progress);
+			}
+		});
+	}
+
+	void BroadcastNewSegments(whisper_context* /*Ctx*/, whisper_state* State, int NumNew, void* UserData)
+	{
+		TArray<FWhisperTranscriptionSegment> NewSegments;
+		const int NSegments = whisper_full_n_segments_from_state(State);
+		for (int i = FMath::Max(NSegments - NumNew, 0); i < NSegments; ++i)
+		{
+			NewSegments.Add(ReadSegment(State, i));
+		}
+
+		TWeakObjectPtr<UWhisperCppTranscription> Owner = static_cast<const FWhisperCallbackTarget*>(UserData)->Owner;
+		AsyncTask(ENamedThreads::GameThread, [Owner, NewSegments = MoveTemp(NewSegments)]()
+		{
+			if (UWhisperCppTranscription* Self = Owner.Get())
+			{
+				for (const FWhisperTranscriptionSegment& Segment : NewSegments)
+				{
+					Self->OnSegmentTranscribed.Broadcast(Segment);
+				}
+			}
+		});
+	}
+
+	/**
+	 * Point Params' callbacks at Target. Cancellation is checked before the encoder and between ggml
+	 * graph nodes, so StopTranscription takes effect mid-decode. With bReportProgress, progress and each
+	 * new segment are also broadcast on the game thread while whisper_full runs.
+	 */
+	void BindCallbacks(whisper_full_params& Params, FWhisperCallbackTarget& Target, bool bReportProgress)
+	{
+		Params.abort_callback = &IsCancelled;
+		Params.abort_callback_user_data = &Target;
+		Params.encoder_begin_callback = [](whisper_context*, whisper_state*, void* UserData) -> bool
+		{
+			return !IsCancelled(UserData);
+		};
+		Params.encoder_begin_callback_user_data = &Target;
+
+		if (bReportProgress)
+		{
+			Params.progress_callback = &BroadcastProgress;
+			Params.progress_callback_user_data = &Target;
+			Params.new_segment_callback = &BroadcastNewSegments;
+			Params.new_segment_callback_user_data = &Target;
+		}
+	}
+
+	/** whisper_full_with_state over Audio, collecting segments into OutResult. */
+	int TranscribeWithState(whisper_context* Ctx, whisper_state* State, const whisper_full_params& Params, const TArray<float>& Audio, FWhisperTranscriptionResult& OutResult)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		const int Ret = whisper_full_with_state(Ctx, State, Params, Audio.GetData(), Audio.Num());
+
+		// Logs the encoder context used next to the time taken, to measure the effect of the audio_ctx policy
+		UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: whisper_full returned %d in %.2fs (%.1fs of audio, audio_ctx=%d of %d)"),
+			Ret, FPlatformTime::Seconds() - StartTime, static_cast<float>(Audio.Num()) / WHISPER_SAMPLE_RATE,
+			Params.audio_ctx > 0 ? Params.audio_ctx : whisper_model_n_audio_ctx(Ctx), whisper_model_n_audio_ctx(Ctx));
+
+		if (Ret != 0)
+		{
+			if (Params.abort_callback && Params.abort_callback(Params.abort_callback_user_data))
+			{
+				UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Transcription cancelled"));
+			}
+			else
+			{
+				UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: whisper_full failed with code %d"), Ret);
+			}
+			return Ret;
+		}
+
+		const int NSegments = whisper_full_n_segments_from_state(State);
+		UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Got %d segments"), NSegments);
+
+		for (int i = 0; i < NSegments; ++i)
+		{
+			FWhisperTranscriptionSegment Segment = ReadSegment(State, i);
+			OutResult.FullText += Segment.Text;
+			OutResult.Segments.Add(MoveTemp(Segment));
+		}
+
+		OutResult.bSuccess = true;
+		UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Transcription complete — %d segments"), NSegments);
+		return Ret;
+	}
+
+	/** Latest pause in Audio[MinSplit, MaxSplit) according to VAD, as a sample index; INDEX_NONE if speech runs through. */
+	int32 FindVadSplit(whisper_vad_context* Vad, const whisper_vad_params& Params, const float* Audio, int32 MinSplit, int32 MaxSplit)
+	{
+		whisper_vad_segments* Segments = whisper_vad_segments_from_samples(Vad, Params, Audio, MaxSplit);
+		if (!Segments)
+		{
+			return INDEX_NONE;
+		}
+
+		// Cut in the middle of a gap between speech segments, or of the silence after the last one
+		int32 Split = INDEX_NONE;
+		const int NSegments = whisper_vad_segments_n_segments(Segments);
+		for (int i = 0; i < NSegments; ++i)
+		{
+			const int32 GapStart = static_cast<int32>(whisper_vad_segments_get_segment_t1(Segments, i) * WHISPER_SAMPLE_RATE / 100.0f);
+			const int32 GapEnd = (i + 1 < NSegments)
+				? static_cast<int32>(whisper_vad_segments_get_segment_t0(Segments, i + 1) * WHISPER_SAMPLE_RATE / 100.0f)
+				: MaxSplit;
+			const int32 Mid = (GapStart + GapEnd) / 2;
+			if (GapEnd > GapStart && Mid >= MinSplit && Mid < MaxSplit)
+			{
+				Split = Mid;
+			}
+		}
+		whisper_vad_free_segments(Segments);
+		return Split;
+	}
+
+	/** Centre of the lowest-energy 20 ms frame in Audio[MinSplit, MaxSplit). */
+	int32 FindQuietestSplit(const float* Audio, int32 MinSplit, int32 MaxSplit)
+	{
+		const int32 FrameSamples = WHISPER_SAMPLE_RATE / 50;
+		int32 Split = MaxSplit;
+		float MinEnergy = TNumericLimits<float>::Max();
+		for (int32 Start = MinSplit; Start + FrameSamples <= MaxSplit; Start += FrameSamples)
+		{
+			float Energy = 0.0f;
+			for (int32 i = Start; i < Start + FrameSamples; ++i)
+			{
+				Energy += Audio[i] * Audio[i];
+			}
+			if (Energy < MinEnergy)
+			{
+				MinEnergy = Energy;
+				Split = Start + FrameSamples / 2;
+			}
+		}
+		return Split;
+	}
+
+	/** Bookkeeping shared by a long-form job's reader thread and its chunk workers. */
+	struct FLongFormJob
+	{
+		FCriticalSection Lock;
+		/** Segments of finished chunks that are still waiting for an earlier chunk, by chunk index. */
+		TMap<int32, TArray<FWhisperTranscriptionSegment>> Finished;
+		int32 NextChunkToEmit = 0;
+		FWhisperTranscriptionResult Result;
+		bool bChunkFailed = false;
+
+		TAtomic<int32> NumInFlight{0};
+		FEvent* ChunkDoneEvent = nullptr;
+
+		FLongFormJob() { ChunkDoneEvent = FPlatformProcess::GetSynchEventFromPool(false); }
+		~FLongFormJob() { FPlatformProcess::ReturnSynchEventToPool(ChunkDoneEvent); }
+	};
+}
+
 UWhisperCppTranscription::UWhisperCppTranscription()
 {
 	TranscriptionDoneEvent = FPlatformProcess::GetSynchEventFromPool(false);
 	RealtimeDoneEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	CaptureBuffer = MakeShared<FWhisperAudioRingBuffer, ESPMode::ThreadSafe>();
+	JobQueue = MakeShared<FWhisperJobQueue, ESPMode::ThreadSafe>();
 }
 
 void UWhisperCppTranscription::BeginDestroy()
 {
 	bIsBeingDestroyed = true;
+
+	// Cancel everything before waiting on anything: the realtime loop holds a decoder state for its whole
+	// session, and jobs waiting for that state only give up once cancelled
+	const bool bWasRealtime = bIsRealtimeTranscribing.Exchange(false);
 	StopTranscription();
-	if (bIsTranscribing)
-	{
-		TranscriptionDoneEvent->Wait();
-	}
 
-	// Stop realtime transcription loop and wait for thread exit
-	if (bIsRealtimeTranscribing)
+	if (bWasRealtime)
 	{
-		bIsRealtimeTranscribing = false;
 		RealtimeDoneEvent->Wait();
 	}
+	while (NumActiveTranscriptions > 0)
+	{
+		TranscriptionDoneEvent->Wait(10);
+	}
 
 	// Clean up audio capture
 	if (bIsCapturing)
@@ -54,7 +319,7 @@ void UWhisperCppTranscription::BeginDestroy()
 	Super::BeginDestroy();
 }
 
-void UWhisperCppTranscription::LoadModel(const FString& ModelPath)
+void UWhisperCppTranscription::LoadModel(const FString& ModelPath, const FString& VadModelPath)
 {
 	if (WhisperCtx)
 	{
@@ -64,13 +329,15 @@ void UWhisperCppTranscription::LoadModel(const FString& ModelPath)
 
 	TWeakObjectPtr<UWhisperCppTranscription> WeakThis(this);
 	FString PathCopy = ModelPath;
+	FString VadPathCopy = VadModelPath;
 
-	Async(EAsyncExecution::Thread, [WeakThis, PathCopy]()
+	Async(EAsyncExecution::Thread, [WeakThis, PathCopy, VadPathCopy]()
 	{
 		whisper_context_params CtxParams = whisper_context_default_params();
 		CtxParams.use_gpu = false; // CPU-only for mobile compatibility
 
-		whisper_context* LoadedCtx = whisper_init_from_file_with_params(
+		// Weights only; each transcription borrows its own decoder state from the pool
+		whisper_context* LoadedCtx = whisper_init_from_file_with_params_no_state(
 			TCHAR_TO_UTF8(*PathCopy), CtxParams);
 
 		bool bSuccess = (LoadedCtx != nullptr);
@@ -80,20 +347,41 @@ void UWhisperCppTranscription::LoadModel(const FString& ModelPath)
 			UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: Failed to load model from %s"), *PathCopy);
 		}
 
-		AsyncTask(ENamedThreads::GameThread, [WeakThis, LoadedCtx, bSuccess]()
+		// VAD is optional; without it everything still works, just without silence gating
+		whisper_vad_context* LoadedVad = nullptr;
+		if (bSuccess && !VadPathCopy.IsEmpty())
+		{
+			whisper_vad_context_params VadCtxParams = whisper_vad_default_context_params();
+			VadCtxParams.n_threads = 1;
+			VadCtxParams.use_gpu = false;
+			LoadedVad = whisper_vad_init_from_file_with_params(TCHAR_TO_UTF8(*VadPathCopy), VadCtxParams);
+			if (!LoadedVad)
+			{
+				UE_LOG(LogWhisperCpp, Warning, TEXT("Whisper: Failed to load VAD model from %s, continuing without VAD"), *VadPathCopy);
+			}
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, LoadedCtx, LoadedVad, VadPathCopy, bSuccess]()
 		{
 			if (UWhisperCppTranscription* Self = WeakThis.Get())
 			{
 				if (bSuccess)
 				{
 					Self->WhisperCtx = LoadedCtx;
-					UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Model loaded successfully"));
+					Self->StatePool = MakeShared<FWhisperStatePool, ESPMode::ThreadSafe>(LoadedCtx, Self->MaxConcurrentTranscriptions);
+					Self->VadCtx = LoadedVad;
+					Self->LoadedVadModelPath = LoadedVad ? VadPathCopy : FString();
+					UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Model loaded successfully%s"), LoadedVad ? TEXT(" (with VAD)") : TEXT(""));
 				}
 				Self->OnModelLoaded.Broadcast(bSuccess);
 			}
 			else if (bSuccess)
 			{
 				whisper_free(LoadedCtx);
+				if (LoadedVad)
+				{
+					whisper_vad_free(LoadedVad);
+				}
 			}
 		});
 	});
@@ -101,11 +389,31 @@ void UWhisperCppTranscription::LoadModel(const FString& ModelPath)
 
 void UWhisperCppTranscription::UnloadModel()
 {
+	// Running work holds decoder states on these weights; let it finish first
+	if (bIsRealtimeTranscribing)
+	{
+		bIsRealtimeTranscribing = false;
+		RealtimeDoneEvent->Wait();
+	}
+	while (NumActiveTranscriptions > 0)
+	{
+		TranscriptionDoneEvent->Wait(10);
+	}
+
+	StatePool.Reset();
+
 	if (WhisperCtx)
 	{
 		whisper_free(WhisperCtx);
 		WhisperCtx = nullptr;
 	}
+
+	if (VadCtx)
+	{
+		whisper_vad_free(VadCtx);
+		VadCtx = nullptr;
+	}
+	LoadedVadModelPath.Empty();
 }
 
 bool UWhisperCppTranscription::IsModelLoaded() const
@@ -113,6 +421,11 @@ bool UWhisperCppTranscription::IsModelLoaded() const
 	return WhisperCtx != nullptr;
 }
 
+bool UWhisperCppTranscription::IsVadModelLoaded() const
+{
+	return VadCtx != nullptr;
+}
+
 void UWhisperCppTranscription::TranscribeWavFileAsync(const FString& WavFilePath, const FString& Language)
 {
 	if (!IsModelLoaded())
@@ -123,12 +436,6 @@ void UWhisperCppTranscription::TranscribeWavFileAsync(const FString& WavFilePath
 		return;
 	}
 
-	if (bIsTranscribing)
-	{
-		UE_LOG(LogWhisperCpp, Warning, TEXT("Whisper: Transcription already in progress"));
-		return;
-	}
-
 	TArray<float> AudioData;
 	int32 SampleRate = 0;
 	int32 NumChannels = 0;
@@ -145,14 +452,361 @@ void UWhisperCppTranscription::TranscribeWavFileAsync(const FString& WavFilePath
 	TArray<float> ResampledData;
 	if (SampleRate != WHISPER_SAMPLE_RATE || NumChannels != 1)
 	{
-		ResampleTo16kMono(AudioData, SampleRate, NumChannels, ResampledData);
+		FLlamaAudioResampler::Convert(AudioData, SampleRate, NumChannels, WHISPER_SAMPLE_RATE, ResampledData);
 	}
 	else
 	{
 		ResampledData = MoveTemp(AudioData);
 	}
 
-	RunTranscription(MoveTemp(ResampledData), Language, MaxThreads, bSingleSegment);
+	RunTranscription(MoveTemp(ResampledData), Language, MaxThreads, bSingleSegment);
+}
+
+void UWhisperCppTranscription::TranscribeLongWavFileAsync(const FString& WavFilePath, const FString& Language)
+{
+	if (!IsModelLoaded() || !StatePool)
+	{
+		UE_LOG(LogWhisperCpp, Warning, TEXT("Whisper: Cannot transcribe — no model loaded"));
+		FWhisperTranscriptionResult EmptyResult;
+		OnTranscriptionComplete.Broadcast(EmptyResult);
+		return;
+	}
+
+	++NumActiveTranscriptions;
+
+	TWeakObjectPtr<UWhisperCppTranscription> WeakThis(this);
+	whisper_context* BgCtx = WhisperCtx;
+	TSharedPtr<FWhisperStatePool, ESPMode::ThreadSafe> Pool = StatePool;
+	TSharedRef<TAtomic<bool>, ESPMode::ThreadSafe> CancelFlag = MakeCancelToken();
+	TAtomic<int32>* ActiveCount = &NumActiveTranscriptions;
+	FEvent* DoneEvent = TranscriptionDoneEvent;
+	const FString VadPath = LoadedVadModelPath;
+	const whisper_vad_params VadParams = MakeVadParams(VadThreshold, VadMinSilenceMs);
+	const FAudioCtxPolicy AudioCtxPolicy = MakeAudioCtxPolicy(bDynamicAudioContext, AudioContextMarginSeconds, MinAudioContextSeconds);
+	const int32 ChunkSamples = static_cast<int32>(FMath::Clamp(LongFormChunkSeconds, 10.0f, 30.0f) * WHISPER_SAMPLE_RATE);
+	// Chunks run side by side, so split the thread budget between them
+	const int32 ThreadsPerChunk = FMath::Max(MaxThreads / FMath::Max(MaxConcurrentTranscriptions, 1), 1);
+
+	Async(EAsyncExecution::Thread, [WeakThis, WavFilePath, Language, BgCtx, Pool, CancelFlag, ActiveCount, DoneEvent, VadPath, VadParams, AudioCtxPolicy, ChunkSamples, ThreadsPerChunk]()
+	{
+		TSharedRef<FLongFormJob, ESPMode::ThreadSafe> Job = MakeShared<FLongFormJob, ESPMode::ThreadSafe>();
+
+		FWhisperWavReader Reader;
+		const bool bOpened = Reader.Open(WavFilePath);
+		if (!bOpened)
+		{
+			UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: Failed to load WAV file: %s"), *WavFilePath);
+		}
+		else
+		{
+			UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Long-form transcription of %s (%.1fs, %d Hz, %d ch)"), *WavFilePath,
+				static_cast<float>(Reader.GetNumFrames()) / Reader.GetSampleRate(), Reader.GetSampleRate(), Reader.GetNumChannels());
+		}
+
+		// A private VAD context for choosing cut points; the realtime loop may be using the shared one
+		whisper_vad_context* SplitVad = nullptr;
+		if (bOpened && !VadPath.IsEmpty())
+		{
+			whisper_vad_context_params VadCtxParams = whisper_vad_default_context_params();
+			VadCtxParams.n_threads = 1;
+			VadCtxParams.use_gpu = false;
+			SplitVad = whisper_vad_init_from_file_with_params(TCHAR_TO_UTF8(*VadPath), VadCtxParams);
+		}
+
+		FLlamaAudioResampler Resampler;
+		if (bOpened)
+		{
+			Resampler.Init(Reader.GetSampleRate(), Reader.GetNumChannels(), WHISPER_SAMPLE_RATE);
+		}
+
+		TArray<float> FileBlock;
+		TArray<float> Pending;       // 16kHz mono audio not handed to a worker yet
+		int64 PendingStart = 0;      // file position of Pending[0], in 16kHz samples
+		int32 NumChunks = 0;
+		bool bEndOfFile = !bOpened;
+		const int32 BlockFrames = FMath::Max(Reader.GetSampleRate(), 1); // one second per read
+		const int32 SearchSamples = 5 * WHISPER_SAMPLE_RATE;
+
+		while (!*CancelFlag && (!bEndOfFile || Pending.Num() > 0))
+		{
+			while (!bEndOfFile && Pending.Num() < ChunkSamples)
+			{
+				FileBlock.Reset();
+				const int32 NumFrames = Reader.Read(BlockFrames, FileBlock);
+				if (NumFrames == 0)
+				{
+					bEndOfFile = true;
+					break;
+				}
+				Resampler.Process(FileBlock.GetData(), NumFrames, Pending);
+			}
+
+			// Cut at a pause near the target length so no word is split between chunks
+			int32 Split = Pending.Num();
+			if (Pending.Num() > ChunkSamples)
+			{
+				const int32 MinSplit = ChunkSamples - SearchSamples;
+				Split = SplitVad ? FindVadSplit(SplitVad, VadParams, Pending.GetData(), MinSplit, ChunkSamples) : INDEX_NONE;
+				if (Split == INDEX_NONE)
+				{
+					Split = FindQuietestSplit(Pending.GetData(), MinSplit, ChunkSamples);
+				}
+			}
+			if (Split <= 0)
+			{
+				break;
+			}
+
+			TArray<float> ChunkAudio(Pending.GetData(), Split);
+			Pending.RemoveAt(0, Split);
+			const int32 ChunkIndex = NumChunks++;
+			const float ChunkOffsetSeconds = static_cast<float>(static_cast<double>(PendingStart) / WHISPER_SAMPLE_RATE);
+			PendingStart += Split;
+
+			// Blocks until a state is free, which caps how much audio is in memory at once
+			whisper_state* State = Pool->Acquire(&*CancelFlag);
+			if (!State)
+			{
+				UE_CLOG(!*CancelFlag, LogWhisperCpp, Error, TEXT("Whisper: No decoder state available for long-form chunk %d"), ChunkIndex);
+				FScopeLock Lock(&Job->Lock);
+				Job->bChunkFailed = true;
+				break;
+			}
+
+			++Job->NumInFlight;
+			Async(EAsyncExecution::Thread, [WeakThis, Job, BgCtx, Pool, CancelFlag, State, ChunkAudio = MoveTemp(ChunkAudio), ChunkIndex, ChunkOffsetSeconds, Language, VadPath, VadParams, AudioCtxPolicy, ThreadsPerChunk]()
+			{
+				whisper_full_params WParams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+				WParams.n_threads = FMath::Clamp(ThreadsPerChunk, 1, FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+				WParams.print_progress = false;
+				WParams.print_realtime = false;
+				WParams.print_timestamps = false;
+				WParams.print_special = false;
+				WParams.no_timestamps = false;
+
+				std::string LanguageUtf8 = TCHAR_TO_UTF8(*Language);
+				WParams.language = LanguageUtf8.c_str();
+				WParams.audio_ctx = AudioCtxPolicy.Apply(BgCtx, ChunkAudio.Num());
+
+				std::string VadPathUtf8 = TCHAR_TO_UTF8(*VadPath);
+				if (!VadPath.IsEmpty())
+				{
+					WParams.vad = true;
+					WParams.vad_model_path = VadPathUtf8.c_str();
+					WParams.vad_params = VadParams;
+				}
+
+				// Segments are emitted in file order below, so only cancellation is wired
+				FWhisperCallbackTarget CallbackTarget{WeakThis, CancelFlag};
+				BindCallbacks(WParams, CallbackTarget, false);
+
+				FWhisperTranscriptionResult ChunkResult;
+				TranscribeWithState(BgCtx, State, WParams, ChunkAudio, ChunkResult);
+				Pool->Release(State);
+
+				for (FWhisperTranscriptionSegment& Segment : ChunkResult.Segments)
+				{
+					Segment.StartTimeSeconds += ChunkOffsetSeconds;
+					Segment.EndTimeSeconds += ChunkOffsetSeconds;
+				}
+
+				{
+					FScopeLock Lock(&Job->Lock);
+					Job->bChunkFailed |= !ChunkResult.bSuccess;
+					Job->Finished.Add(ChunkIndex, MoveTemp(ChunkResult.Segments));
+
+					// Release every chunk that is now contiguous with what was already emitted
+					TArray<FWhisperTranscriptionSegment> Ready;
+					TArray<FWhisperTranscriptionSegment> ChunkSegments;
+					while (Job->Finished.RemoveAndCopyValue(Job->NextChunkToEmit, ChunkSegments))
+					{
+						++Job->NextChunkToEmit;
+						for (const FWhisperTranscriptionSegment& Segment : ChunkSegments)
+						{
+							Job->Result.FullText += Segment.Text;
+							Job->Result.Segments.Add(Segment);
+						}
+						Ready.Append(MoveTemp(ChunkSegments));
+					}
+
+					// Queued under the lock so game-thread broadcasts keep file order
+					if (Ready.Num() > 0)
+					{
+						AsyncTask(ENamedThreads::GameThread, [WeakThis, Ready = MoveTemp(Ready)]()
+						{
+							if (UWhisperCppTranscription* Self = WeakThis.Get())
+							{
+								for (const FWhisperTranscriptionSegment& Segment : Ready)
+								{
+									Self->OnSegmentTranscribed.Broadcast(Segment);
+								}
+							}
+						});
+					}
+				}
+
+				--Job->NumInFlight;
+				Job->ChunkDoneEvent->Trigger();
+			});
+		}
+
+		while (Job->NumInFlight > 0)
+		{
+			Job->ChunkDoneEvent->Wait(10);
+		}
+
+		if (SplitVad)
+		{
+			whisper_vad_free(SplitVad);
+		}
+
+		FWhisperTranscriptionResult Result;
+		{
+			FScopeLock Lock(&Job->Lock);
+			Result = MoveTemp(Job->Result);
+			Result.bSuccess = bOpened && !*CancelFlag && !Job->bChunkFailed;
+		}
+
+		UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Long-form transcription %s — %d chunks, %d segments"),
+			Result.bSuccess ? TEXT("complete") : TEXT("stopped"), NumChunks, Result.Segments.Num());
+
+		// Trigger first: once the count reaches zero BeginDestroy may return the event to the pool
+		DoneEvent->Trigger();
+		--(*ActiveCount);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Result = MoveTemp(Result)]()
+		{
+			if (UWhisperCppTranscription* Self = WeakThis.Get())
+			{
+				Self->OnTranscriptionComplete.Broadcast(Result);
+			}
+		});
+	});
+}
+
+int32 UWhisperCppTranscription::EnqueueTranscription(const FString& WavFilePath, const FWhisperTranscriptionOptions& Options)
+{
+	if (!IsModelLoaded() || !StatePool)
+	{
+		UE_LOG(LogWhisperCpp, Warning, TEXT("Whisper: Cannot queue %s — no model loaded"), *WavFilePath);
+		return INDEX_NONE;
+	}
+
+	const int32 JobId = JobQueue->Enqueue(WavFilePath, Options, MakeCancelToken());
+
+	// Workers exit when the queue runs dry, so start one whenever there is room
+	if (JobQueue->TryAddWorker(NumQueueWorkers))
+	{
+		QueueWorkerLoop();
+	}
+	return JobId;
+}
+
+FWhisperQueueStats UWhisperCppTranscription::GetQueueStats() const
+{
+	return JobQueue->GetStats();
+}
+
+void UWhisperCppTranscription::ResetQueueStats()
+{
+	JobQueue->ResetStats();
+}
+
+void UWhisperCppTranscription::QueueWorkerLoop()
+{
+	++NumActiveTranscriptions;
+
+	TWeakObjectPtr<UWhisperCppTranscription> WeakThis(this);
+	whisper_context* BgCtx = WhisperCtx;
+	TSharedPtr<FWhisperStatePool, ESPMode::ThreadSafe> Pool = StatePool;
+	TSharedPtr<FWhisperJobQueue, ESPMode::ThreadSafe> Queue = JobQueue;
+	TAtomic<int32>* ActiveCount = &NumActiveTranscriptions;
+	FEvent* DoneEvent = TranscriptionDoneEvent;
+	const FString VadPath = LoadedVadModelPath;
+	const whisper_vad_params VadParams = MakeVadParams(VadThreshold, VadMinSilenceMs);
+	const FAudioCtxPolicy AudioCtxPolicy = MakeAudioCtxPolicy(bDynamicAudioContext, AudioContextMarginSeconds, MinAudioContextSeconds);
+	const int32 ThreadsPerJob = FMath::Max(MaxThreads / FMath::Max(NumQueueWorkers, 1), 1);
+
+	Async(EAsyncExecution::Thread, [WeakThis, BgCtx, Pool, Queue, ActiveCount, DoneEvent, VadPath, VadParams, AudioCtxPolicy, ThreadsPerJob]()
+	{
+		FWhisperQueuedJob Job;
+		while (Queue->PopOrRetire(Job))
+		{
+			FWhisperTranscriptionResult Result;
+			double AudioSeconds = 0.0;
+			double DecodeSeconds = 0.0;
+
+			// After StopTranscription the rest of the queue is drained as failed jobs
+			TArray<float> AudioData;
+			FWhisperWavReader Reader;
+			if (!*Job.CancelFlag && Reader.Open(Job.WavFilePath))
+			{
+				TArray<float> FileAudio;
+				Reader.Read(static_cast<int32>(FMath::Min<int64>(Reader.GetNumFrames(), MAX_int32 / Reader.GetNumChannels())), FileAudio);
+				FLlamaAudioResampler::Convert(FileAudio, Reader.GetSampleRate(), Reader.GetNumChannels(), WHISPER_SAMPLE_RATE, AudioData);
+				AudioSeconds = static_cast<double>(AudioData.Num()) / WHISPER_SAMPLE_RATE;
+			}
+			else if (!*Job.CancelFlag)
+			{
+				UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: Failed to load WAV file: %s"), *Job.WavFilePath);
+			}
+
+			if (AudioData.Num() > 0)
+			{
+				whisper_full_params WParams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+				WParams.n_threads = FMath::Clamp(ThreadsPerJob, 1, FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+				WParams.print_progress = false;
+				WParams.print_realtime = false;
+				WParams.print_timestamps = false;
+				WParams.print_special = false;
+				WParams.single_segment = Job.Options.bSingleSegment;
+				WParams.no_timestamps = false;
+
+				std::string LanguageUtf8 = TCHAR_TO_UTF8(*Job.Options.Language);
+				WParams.language = LanguageUtf8.c_str();
+				WParams.audio_ctx = AudioCtxPolicy.Apply(BgCtx, AudioData.Num());
+
+				std::string VadPathUtf8 = TCHAR_TO_UTF8(*VadPath);
+				if (Job.Options.bUseVad && !VadPath.IsEmpty())
+				{
+					WParams.vad = true;
+					WParams.vad_model_path = VadPathUtf8.c_str();
+					WParams.vad_params = VadParams;
+				}
+
+				FWhisperCallbackTarget CallbackTarget{WeakThis, Job.CancelFlag};
+				BindCallbacks(WParams, CallbackTarget, false);
+
+				if (whisper_state* State = Pool->Acquire(&*Job.CancelFlag))
+				{
+					const double StartTime = FPlatformTime::Seconds();
+					TranscribeWithState(BgCtx, State, WParams, AudioData, Result);
+					DecodeSeconds = FPlatformTime::Seconds() - StartTime;
+					Pool->Release(State);
+				}
+				else
+				{
+					UE_CLOG(!*Job.CancelFlag, LogWhisperCpp, Error, TEXT("Whisper: No decoder state available for job %d"), Job.JobId);
+				}
+			}
+
+			Queue->RecordJob(Result.bSuccess, AudioSeconds, DecodeSeconds);
+			UE_LOG(LogWhisperCpp, Verbose, TEXT("Whisper: Job %d %s — %.1fs of audio in %.2fs"),
+				Job.JobId, Result.bSuccess ? TEXT("done") : TEXT("failed"), AudioSeconds, DecodeSeconds);
+
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, JobId = Job.JobId, Result = MoveTemp(Result)]()
+			{
+				if (UWhisperCppTranscription* Self = WeakThis.Get())
+				{
+					Self->OnJobComplete.Broadcast(JobId, Result);
+				}
+			});
+		}
+
+		// Trigger first: once the count reaches zero BeginDestroy may return the event to the pool
+		DoneEvent->Trigger();
+		--(*ActiveCount);
+	});
 }
 
 void UWhisperCppTranscription::StartMicrophoneCapture()
@@ -163,12 +817,8 @@ void UWhisperCppTranscription::StartMicrophoneCapture()
 		return;
 	}
 
-	{
-		FScopeLock Lock(&CapturedAudioLock);
-		CapturedAudioData.Empty();
-		CaptureSampleRate = 0.0f;
-		CaptureNumChannels = 0;
-	}
+	CaptureSampleRate = 0.0f;
+	CaptureNumChannels = 0;
 	bHasReceivedAudio = false;
 
 	if (!AudioCapture)
@@ -189,6 +839,12 @@ void UWhisperCppTranscription::StartMicrophoneCapture()
 		DeviceInfo.PreferredSampleRate,
 		DeviceInfo.InputChannels);
 
+	// Sized once up front so the device callback never allocates
+	const float BufferSeconds = FMath::Max(MaxCaptureSeconds, RealtimeMaxWindowSeconds);
+	const int32 BufferChannels = FMath::Max(DeviceInfo.InputChannels, 1);
+	const int32 BufferRate = DeviceInfo.PreferredSampleRate > 0 ? DeviceInfo.PreferredSampleRate : 48000;
+	CaptureBuffer->Reset(static_cast<int32>(BufferSeconds * BufferRate) * BufferChannels, BufferChannels);
+
 	Audio::FAudioCaptureDeviceParams Params;
 	Audio::FOnAudioCaptureFunction OnCapture = [this](const void* InAudio, int32 NumFrames, int32 InNumChannels, int32 InSampleRate, double StreamTime, bool bOverflow)
 	{
@@ -203,11 +859,11 @@ void UWhisperCppTranscription::StartMicrophoneCapture()
 		CaptureSampleRate = static_cast<float>(InSampleRate);
 		CaptureNumChannels = InNumChannels;
 
-		FScopeLock Lock(&CapturedAudioLock);
-		int32 NumSamples = NumFrames * InNumChannels;
-		int32 OldNum = CapturedAudioData.Num();
-		CapturedAudioData.SetNum(OldNum + NumSamples);
-		FMemory::Memcpy(CapturedAudioData.GetData() + OldNum, AudioData, NumSamples * sizeof(float));
+		if (bOverflow)
+		{
+			CaptureBuffer->AddDeviceOverflow();
+		}
+		CaptureBuffer->Write(AudioData, NumFrames * InNumChannels);
 	};
 
 	if (!AudioCapture->OpenAudioCaptureStream(Params, MoveTemp(OnCapture), 1024))
@@ -242,15 +898,18 @@ void UWhisperCppTranscription::StopMicrophoneCaptureAndTranscribe(const FString&
 	}
 
 	TArray<float> CapturedSnapshot;
-	{
-		FScopeLock Lock(&CapturedAudioLock);
-		CapturedSnapshot = MoveTemp(CapturedAudioData);
-		CapturedAudioData.Reset();
-	}
+	int64 ReadCursor = 0;
+	CaptureBuffer->Read(ReadCursor, CapturedSnapshot);
 
 	bIsCapturing = false;
 	UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Microphone capture stopped, %d samples captured"), CapturedSnapshot.Num());
 
+	if (CaptureBuffer->GetDroppedSamples() > 0 || CaptureBuffer->GetDeviceOverflows() > 0)
+	{
+		UE_LOG(LogWhisperCpp, Warning, TEXT("Whisper: Capture overflowed — %lld samples dropped, %d device overflows (recording longer than MaxCaptureSeconds?)"),
+			CaptureBuffer->GetDroppedSamples(), CaptureBuffer->GetDeviceOverflows());
+	}
+
 	if (!IsModelLoaded())
 	{
 		UE_LOG(LogWhisperCpp, Warning, TEXT("Whisper: Cannot transcribe — no model loaded"));
@@ -279,7 +938,7 @@ void UWhisperCppTranscription::StopMicrophoneCaptureAndTranscribe(const FString&
 	int32 SrcSampleRate = static_cast<int32>(CaptureSampleRate);
 	if (SrcSampleRate != WHISPER_SAMPLE_RATE || CaptureNumChannels != 1)
 	{
-		ResampleTo16kMono(CapturedSnapshot, SrcSampleRate, CaptureNumChannels, ResampledData);
+		FLlamaAudioResampler::Convert(CapturedSnapshot, SrcSampleRate, CaptureNumChannels, WHISPER_SAMPLE_RATE, ResampledData);
 	}
 	else
 	{
@@ -320,6 +979,21 @@ void UWhisperCppTranscription::StopMicrophoneCaptureAndTranscribe(const FString&
 	RunTranscription(MoveTemp(ResampledData), Language, MaxThreads, bSingleSegment);
 }
 
+int32 UWhisperCppTranscription::GetAudioContextForClip(float ClipSeconds) const
+{
+	if (!WhisperCtx)
+	{
+		return 0;
+	}
+	const FAudioCtxPolicy Policy = MakeAudioCtxPolicy(bDynamicAudioContext, AudioContextMarginSeconds, MinAudioContextSeconds);
+	return Policy.Apply(WhisperCtx, static_cast<int32>(FMath::Max(ClipSeconds, 0.0f) * WHISPER_SAMPLE_RATE));
+}
+
+int64 UWhisperCppTranscription::GetDroppedCaptureSamples() const
+{
+	return CaptureBuffer->GetDroppedSamples();
+}
+
 bool UWhisperCppTranscription::IsCapturing() const
 {
 	return bIsCapturing;
@@ -327,38 +1001,59 @@ bool UWhisperCppTranscription::IsCapturing() const
 
 void UWhisperCppTranscription::StopTranscription()
 {
-	bCancelTranscription = true;
+	// Only jobs already started; anything begun afterwards gets a fresh flag
+	FScopeLock Lock(&CancelTokensLock);
+	for (const TSharedRef<TAtomic<bool>, ESPMode::ThreadSafe>& Token : CancelTokens)
+	{
+		*Token = true;
+	}
+	CancelTokens.Reset();
 }
 
-void UWhisperCppTranscription::RunTranscription(TArray<float> AudioData, const FString& Language, int32 NumThreads, bool bUseSingleSegment)
+TSharedRef<TAtomic<bool>, ESPMode::ThreadSafe> UWhisperCppTranscription::MakeCancelToken()
 {
-	bCancelTranscription = false;
-	bIsTranscribing = true;
+	TSharedRef<TAtomic<bool>, ESPMode::ThreadSafe> Token = MakeShared<TAtomic<bool>, ESPMode::ThreadSafe>(false);
 
-	if (!WhisperCtx)
+	FScopeLock Lock(&CancelTokensLock);
+	// Finished jobs have dropped their reference, leaving only ours
+	CancelTokens.RemoveAllSwap([](const TSharedRef<TAtomic<bool>, ESPMode::ThreadSafe>& Existing)
+	{
+		return Existing.GetSharedReferenceCount() == 1;
+	});
+	CancelTokens.Add(Token);
+	return Token;
+}
+
+void UWhisperCppTranscription::RunTranscription(TArray<float> AudioData, const FString& Language, int32 NumThreads, bool bUseSingleSegment)
+{
+	if (!WhisperCtx || !StatePool)
 	{
 		UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: Cannot transcribe - model not loaded (WhisperCtx is null)"));
-		bIsTranscribing = false;
 		return;
 	}
 
 	if (AudioData.Num() == 0)
 	{
 		UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: Cannot transcribe - no audio data"));
-		bIsTranscribing = false;
 		return;
 	}
 
+	++NumActiveTranscriptions;
+
 	TWeakObjectPtr<UWhisperCppTranscription> WeakThis(this);
 	whisper_context* BgCtx = WhisperCtx;
-	TAtomic<bool>* CancelFlag = &bCancelTranscription;
-	TAtomic<bool>* TranscribingFlag = &bIsTranscribing;
+	TSharedPtr<FWhisperStatePool, ESPMode::ThreadSafe> Pool = StatePool;
+	TSharedRef<TAtomic<bool>, ESPMode::ThreadSafe> CancelFlag = MakeCancelToken();
+	TAtomic<int32>* ActiveCount = &NumActiveTranscriptions;
 	FEvent* DoneEvent = TranscriptionDoneEvent;
+	const FString VadPath = LoadedVadModelPath;
+	const whisper_vad_params VadParams = MakeVadParams(VadThreshold, VadMinSilenceMs);
+	const FAudioCtxPolicy AudioCtxPolicy = MakeAudioCtxPolicy(bDynamicAudioContext, AudioContextMarginSeconds, MinAudioContextSeconds);
 
 	UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Starting transcription with %d samples (%.1fs)"),
 		AudioData.Num(), static_cast<float>(AudioData.Num()) / WHISPER_SAMPLE_RATE);
 
-	Async(EAsyncExecution::Thread, [WeakThis, AudioData = MoveTemp(AudioData), Language, BgCtx, CancelFlag, TranscribingFlag, DoneEvent, NumThreads, bUseSingleSegment]()
+	Async(EAsyncExecution::Thread, [WeakThis, AudioData = MoveTemp(AudioData), Language, BgCtx, Pool, CancelFlag, ActiveCount, DoneEvent, NumThreads, bUseSingleSegment, VadPath, VadParams, AudioCtxPolicy]()
 	{
 		FWhisperTranscriptionResult Result;
 
@@ -391,52 +1086,40 @@ void UWhisperCppTranscription::RunTranscription(TArray<float> AudioData, const F
 
 		std::string LanguageUtf8 = TCHAR_TO_UTF8(*Language);
 		WParams.language = LanguageUtf8.c_str();
+		WParams.audio_ctx = AudioCtxPolicy.Apply(BgCtx, AudioData.Num());
 
-		WParams.abort_callback = nullptr;
-		WParams.abort_callback_user_data = nullptr;
-
-#if !UE_BUILD_SHIPPING
-		UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Calling whisper_full - samples=%d, data=%p, ctx=%p, n_threads=%d, lang=%s"),
-			AudioData.Num(), AudioData.GetData(), BgCtx, WParams.n_threads,
-			UTF8_TO_TCHAR(WParams.language ? WParams.language : "null"));
-#endif
-
-		int Ret = whisper_full(BgCtx, WParams, AudioData.GetData(), AudioData.Num());
+		FWhisperCallbackTarget CallbackTarget{WeakThis, CancelFlag};
+		BindCallbacks(WParams, CallbackTarget, true);
 
-		UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: whisper_full returned %d"), Ret);
-
-		if (Ret == 0)
+		// whisper drops the silence itself and maps segment times back to the original audio
+		std::string VadPathUtf8 = TCHAR_TO_UTF8(*VadPath);
+		if (!VadPath.IsEmpty())
 		{
-			int NSegments = whisper_full_n_segments(BgCtx);
-			UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Got %d segments"), NSegments);
-			FString FullText;
-
-			for (int i = 0; i < NSegments; ++i)
-			{
-				const char* SegText = whisper_full_get_segment_text(BgCtx, i);
-				int64_t T0 = whisper_full_get_segment_t0(BgCtx, i);
-				int64_t T1 = whisper_full_get_segment_t1(BgCtx, i);
-
-				FWhisperTranscriptionSegment Segment;
-				Segment.Text = UTF8_TO_TCHAR(SegText);
-				Segment.StartTimeSeconds = static_cast<float>(T0) / 100.0f;
-				Segment.EndTimeSeconds = static_cast<float>(T1) / 100.0f;
+			WParams.vad = true;
+			WParams.vad_model_path = VadPathUtf8.c_str();
+			WParams.vad_params = VadParams;
+		}
 
-				Result.Segments.Add(Segment);
-				FullText += Segment.Text;
-			}
+		// Waits here while every state is busy with another transcription
+		if (whisper_state* State = Pool->Acquire(&*CancelFlag))
+		{
+#if !UE_BUILD_SHIPPING
+			UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Calling whisper_full - samples=%d, data=%p, ctx=%p, state=%p, n_threads=%d, lang=%s"),
+				AudioData.Num(), AudioData.GetData(), BgCtx, State, WParams.n_threads,
+				UTF8_TO_TCHAR(WParams.language ? WParams.language : "null"));
+#endif
 
-			Result.FullText = FullText;
-			Result.bSuccess = true;
-			UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Transcription complete — %d segments"), NSegments);
+			TranscribeWithState(BgCtx, State, WParams, AudioData, Result);
+			Pool->Release(State);
 		}
 		else
 		{
-			UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: whisper_full failed with code %d"), Ret);
+			UE_CLOG(!*CancelFlag, LogWhisperCpp, Error, TEXT("Whisper: No decoder state available for transcription"));
 		}
 
-		*TranscribingFlag = false;
+		// Trigger first: once the count reaches zero BeginDestroy may return the event to the pool
 		DoneEvent->Trigger();
+		--(*ActiveCount);
 
 		AsyncTask(ENamedThreads::GameThread, [WeakThis, Result]()
 		{
@@ -463,7 +1146,7 @@ void UWhisperCppTranscription::StartRealtimeTranscription(const FString& Languag
 	}
 
 	AccumulatedTranscription.Empty();
-	LastWindowText.Empty();
+	PendingRealtimeText.Empty();
 
 	// Start mic capture if not already capturing
 	if (!bIsCapturing)
@@ -504,6 +1187,17 @@ void UWhisperCppTranscription::StopRealtimeTranscription()
 		bIsCapturing = false;
 	}
 
+	// Words the last pass heard but never confirmed are still the best guess for the tail
+	if (!PendingRealtimeText.IsEmpty())
+	{
+		if (!AccumulatedTranscription.IsEmpty())
+		{
+			AccumulatedTranscription += TEXT(" ");
+		}
+		AccumulatedTranscription += PendingRealtimeText;
+		PendingRealtimeText.Empty();
+	}
+
 	// Fire OnTranscriptionComplete with accumulated text
 	FWhisperTranscriptionResult FinalResult;
 	FinalResult.FullText = AccumulatedTranscription;
@@ -518,18 +1212,175 @@ bool UWhisperCppTranscription::IsRealtimeTranscribing() const
 	return bIsRealtimeTranscribing;
 }
 
+namespace
+{
+	/** One word of a realtime pass, with the tokens that spell it and where it ends in the window. */
+	struct FRealtimeWord
+	{
+		FString Text;
+		FString Key;
+		TArray<whisper_token> Tokens;
+		int64 EndCentiseconds = 0;
+	};
+
+	/** Lowercase, trimmed and without trailing punctuation, so passes that only re-punctuate still agree. */
+	FString MakeWordKey(const FString& Text)
+	{
+		FString Key = Text.TrimStartAndEnd().ToLower();
+		while (Key.Len() > 0 && FChar::IsPunct(Key[Key.Len() - 1]))
+		{
+			Key.LeftChopInline(1);
+		}
+		return Key;
+	}
+
+	/** Split the last whisper_full result into words. A token starting with a space starts a new word. */
+	void CollectWindowWords(whisper_context* Ctx, whisper_state* State, TArray<FRealtimeWord>& OutWords)
+	{
+		OutWords.Reset();
+		const whisper_token Eot = whisper_token_eot(Ctx);
+		std::string Pending;
+
+		auto FinishWord = [&OutWords, &Pending]()
+		{
+			if (OutWords.Num() > 0 && !Pending.empty())
+			{
+				FRealtimeWord& Word = OutWords.Last();
+				Word.Text = UTF8_TO_TCHAR(Pending.c_str());
+				Word.Key = MakeWordKey(Word.Text);
+			}
+			Pending.clear();
+		};
+
+		const int NSegments = whisper_full_n_segments_from_state(State);
+		for (int Seg = 0; Seg < NSegments; ++Seg)
+		{
+			const int NTokens = whisper_full_n_tokens_from_state(State, Seg);
+
+			// Without token timestamps, spread the segment's span over its tokens by text length
+			const int64 SegmentT0 = whisper_full_get_segment_t0_from_state(State, Seg);
+			const int64 SegmentT1 = whisper_full_get_segment_t1_from_state(State, Seg);
+			int64 SegmentChars = 0;
+			for (int i = 0; i < NTokens; ++i)
+			{
+				if (whisper_full_get_token_id_from_state(State, Seg, i) < Eot)
+				{
+					SegmentChars += FCStringAnsi::Strlen(whisper_full_get_token_text_from_state(Ctx, State, Seg, i));
+				}
+			}
+			int64 CharsSoFar = 0;
+
+			for (int i = 0; i < NTokens; ++i)
+			{
+				const whisper_token_data Data = whisper_full_get_token_data_from_state(State, Seg, i);
+				if (Data.id >= Eot)
+				{
+					continue; // timestamps and other special tokens
+				}
+
+				const char* Piece = whisper_full_get_token_text_from_state(Ctx, State, Seg, i);
+				CharsSoFar += FCStringAnsi::Strlen(Piece);
+				if (OutWords.Num() == 0 || Piece[0] == ' ')
+				{
+					FinishWord();
+					OutWords.AddDefaulted();
+				}
+
+				FRealtimeWord& Word = OutWords.Last();
+				Pending += Piece;
+				Word.Tokens.Add(Data.id);
+				Word.EndCentiseconds = Data.t1 >= 0 ? Data.t1 : SegmentT0 + (SegmentT1 - SegmentT0) * CharsSoFar / FMath::Max<int64>(SegmentChars, 1);
+			}
+		}
+		FinishWord();
+
+		OutWords.RemoveAll([](const FRealtimeWord& Word) { return Word.Key.IsEmpty(); });
+	}
+
+	/** LocalAgreement-2: the words both passes start with. */
+	int32 CountAgreedWords(const TArray<FRealtimeWord>& Previous, const TArray<FRealtimeWord>& Current)
+	{
+		const int32 Limit = FMath::Min(Previous.Num(), Current.Num());
+		int32 Agreed = 0;
+		while (Agreed < Limit && Previous[Agreed].Key == Current[Agreed].Key)
+		{
+			++Agreed;
+		}
+		return Agreed;
+	}
+
+	FString JoinWords(const TArray<FRealtimeWord>& Words, int32 Begin, int32 End)
+	{
+		FString Text;
+		for (int32 i = Begin; i < End; ++i)
+		{
+			Text += Words[i].Text;
+		}
+		return Text.TrimStartAndEnd();
+	}
+}
+
 void UWhisperCppTranscription::RealtimeTranscriptionLoop(FString Language, float IntervalSeconds)
 {
 	TWeakObjectPtr<UWhisperCppTranscription> WeakThis(this);
 	whisper_context* BgCtx = WhisperCtx;
+	TSharedPtr<FWhisperStatePool, ESPMode::ThreadSafe> Pool = StatePool;
 	TAtomic<bool>* RealtimeFlag = &bIsRealtimeTranscribing;
 	FEvent* DoneEvent = RealtimeDoneEvent;
 	int32 NumThreads = MaxThreads;
 	bool bUseSingleSegment = bSingleSegment;
-
-	Async(EAsyncExecution::Thread, [WeakThis, Language, IntervalSeconds, BgCtx, RealtimeFlag, DoneEvent, NumThreads, bUseSingleSegment]()
+	const int32 MaxWindowSamples = static_cast<int32>(FMath::Clamp(RealtimeMaxWindowSeconds, 2.0f, 30.0f) * WHISPER_SAMPLE_RATE);
+	const int32 MaxPromptTokens = FMath::Clamp(RealtimePromptTokens, 0, 224);
+	whisper_vad_context* BgVadCtx = VadCtx;
+	const whisper_vad_params VadParams = MakeVadParams(VadThreshold, VadMinSilenceMs);
+	const FAudioCtxPolicy AudioCtxPolicy = MakeAudioCtxPolicy(bDynamicAudioContext, AudioContextMarginSeconds, MinAudioContextSeconds);
+	const int32 MinSilenceSamples = FMath::Max(VadMinSilenceMs, 0) * WHISPER_SAMPLE_RATE / 1000;
+	const bool bIncrementalMel = bRealtimeIncrementalMel;
+
+	Async(EAsyncExecution::Thread, [WeakThis, Language, IntervalSeconds, BgCtx, Pool, RealtimeFlag, DoneEvent, NumThreads, bUseSingleSegment, MaxWindowSamples, MaxPromptTokens, BgVadCtx, VadParams, MinSilenceSamples, AudioCtxPolicy, bIncrementalMel]()
 	{
-		const int32 MaxWindowSamples = 30 * WHISPER_SAMPLE_RATE; // 30 seconds at 16kHz = 480000
+		// whisper_full produces nothing for less than a second of audio
+		const int32 MinWindowSamples = WHISPER_SAMPLE_RATE;
+
+		// Lead-in kept while idle so the first syllable of the next utterance is not clipped
+		const int32 IdleKeepSamples = WHISPER_SAMPLE_RATE / 2;
+		bool bInUtterance = false;
+		FString UtteranceText;
+
+		// The loop keeps one decoder state for the whole session
+		whisper_state* State = Pool->Acquire();
+		if (!State)
+		{
+			UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: No decoder state available for realtime transcription"));
+			*RealtimeFlag = false;
+		}
+
+		TArray<float> Window;                 // 16kHz mono audio not committed yet
+		int64 ReadCursor = 0;                 // position in the capture ring buffer
+		FLlamaAudioResampler Resampler;
+		TArray<FRealtimeWord> PreviousWords;  // uncommitted words of the last pass
+		TArray<FRealtimeWord> Words;
+		TArray<whisper_token> CommittedTokens;
+		std::string LanguageUtf8 = TCHAR_TO_UTF8(*Language);
+
+		FWhisperMelStream MelStream;
+		TArray<float> Mel;
+		if (bIncrementalMel)
+		{
+			MelStream.Init(whisper_model_n_mels(BgCtx), MaxWindowSamples / WHISPER_HOP_LENGTH + 64);
+		}
+
+		// With the incremental mel front-end the window only moves by whole hops, so cached frames stay aligned
+		auto DropFront = [&Window, &MelStream, bIncrementalMel](int32 NumSamples) -> int32
+		{
+			if (bIncrementalMel)
+			{
+				NumSamples -= NumSamples % WHISPER_HOP_LENGTH;
+				MelStream.Discard(NumSamples);
+			}
+			Window.RemoveAt(0, NumSamples);
+			return NumSamples;
+		};
 
 		while (*RealtimeFlag)
 		{
@@ -540,357 +1391,290 @@ void UWhisperCppTranscription::RealtimeTranscriptionLoop(FString Language, float
 				break;
 			}
 
-			// Copy current audio buffer under lock
-			TArray<float> AudioSnapshot;
+			// Copy only the audio captured since the last tick
+			TArray<float> NewAudio;
 			float SrcSampleRate = 0.0f;
 			int32 SrcNumChannels = 0;
-			bool bGotAudio = false;
 
 			if (UWhisperCppTranscription* Self = WeakThis.Get())
 			{
-				{
-					FScopeLock Lock(&Self->CapturedAudioLock);
-					AudioSnapshot = Self->CapturedAudioData;
-					SrcSampleRate = Self->CaptureSampleRate;
-					SrcNumChannels = Self->CaptureNumChannels;
-				}
-				bGotAudio = AudioSnapshot.Num() > 0;
+				SrcSampleRate = Self->CaptureSampleRate;
+				SrcNumChannels = Self->CaptureNumChannels;
+				Self->CaptureBuffer->Read(ReadCursor, NewAudio);
 			}
 			else
 			{
 				break;
 			}
 
-			if (!bGotAudio || SrcSampleRate <= 0.0f || SrcNumChannels <= 0)
+			if (NewAudio.Num() > 0 && SrcSampleRate > 0.0f && SrcNumChannels > 0)
 			{
-				UE_LOG(LogWhisperCpp, Verbose, TEXT("Whisper: Realtime loop — no audio yet (samples=%d, rate=%.0f, ch=%d)"),
-					AudioSnapshot.Num(), SrcSampleRate, SrcNumChannels);
-				continue;
+				// Filter state carries over between ticks, so chunk boundaries leave no seams
+				Resampler.Init(static_cast<int32>(SrcSampleRate), SrcNumChannels, WHISPER_SAMPLE_RATE);
+				Resampler.Process(NewAudio.GetData(), NewAudio.Num() / SrcNumChannels, Window);
 			}
 
-			UE_LOG(LogWhisperCpp, Log, TEXT("Whisper: Realtime loop — processing %d samples (rate=%.0f, ch=%d)"),
-				AudioSnapshot.Num(), SrcSampleRate, SrcNumChannels);
-
-			// Resample to 16kHz mono
-			TArray<float> ResampledData;
-			int32 IntSampleRate = static_cast<int32>(SrcSampleRate);
-
-			if (IntSampleRate != WHISPER_SAMPLE_RATE || SrcNumChannels != 1)
+			if (Window.Num() < MinWindowSamples)
 			{
-				// Inline resampling (can't call member function from background thread safely)
-				// Downmix to mono
-				TArray<float> MonoData;
-				int32 NumFrames = AudioSnapshot.Num() / SrcNumChannels;
+				UE_LOG(LogWhisperCpp, Verbose, TEXT("Whisper: Realtime loop — waiting for audio (window=%d samples, rate=%.0f, ch=%d)"),
+					Window.Num(), SrcSampleRate, SrcNumChannels);
+				continue;
+			}
 
-				if (SrcNumChannels > 1)
+			// With a VAD model, whisper only runs while someone is talking
+			bool bUtteranceStarted = false;
+			bool bUtteranceEnded = false;
+			int32 DecodeSamples = Window.Num();
+			if (BgVadCtx)
+			{
+				int32 SpeechStart = 0;
+				int32 SpeechEnd = 0;
+				if (FindSpeech(BgVadCtx, VadParams, Window, SpeechStart, SpeechEnd))
 				{
-					MonoData.SetNum(NumFrames);
-					for (int32 i = 0; i < NumFrames; ++i)
+					if (!bInUtterance)
 					{
-						float Sum = 0.0f;
-						for (int32 c = 0; c < SrcNumChannels; ++c)
-						{
-							Sum += AudioSnapshot[i * SrcNumChannels + c];
-						}
-						MonoData[i] = Sum / static_cast<float>(SrcNumChannels);
+						bInUtterance = true;
+						bUtteranceStarted = true;
 					}
+					SpeechEnd -= DropFront(SpeechStart);
+
+					// Enough silence after the last speech ends the utterance; decode just the speech one last time
+					bUtteranceEnded = Window.Num() - SpeechEnd >= MinSilenceSamples;
+					DecodeSamples = bUtteranceEnded ? SpeechEnd : Window.Num();
+				}
+				else if (bInUtterance)
+				{
+					// The speech was already decoded and committed up to its tentative tail; that tail is final now
+					bUtteranceEnded = true;
+					DecodeSamples = 0;
 				}
 				else
 				{
-					MonoData = MoveTemp(AudioSnapshot);
+					DropFront(FMath::Max(Window.Num() - IdleKeepSamples, 0));
+					continue;
 				}
+			}
 
-				// Resample
-				if (IntSampleRate == WHISPER_SAMPLE_RATE)
+			if (DecodeSamples > 0)
+			{
+				// Normalize what whisper sees; Window keeps the raw samples
+				float Gain = 1.0f;
 				{
-					ResampledData = MoveTemp(MonoData);
+					float PeakAbs = 0.0f;
+					for (int32 i = 0; i < DecodeSamples; ++i)
+					{
+						float Abs = FMath::Abs(Window[i]);
+						if (Abs > PeakAbs) PeakAbs = Abs;
+					}
+					if (PeakAbs > 0.0f && PeakAbs < 0.5f)
+					{
+						Gain = 0.9f / PeakAbs;
+					}
 				}
-				else
+
+				// Run whisper
+				whisper_full_params WParams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+				WParams.n_threads = FMath::Clamp(NumThreads, 1, FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+				WParams.print_progress = false;
+				WParams.print_special = false;
+				WParams.print_realtime = false;
+				WParams.print_timestamps = false;
+				WParams.single_segment = bUseSingleSegment;
+				WParams.no_timestamps = false;
+				// Token timestamps need the PCM whisper only sees without the mel front-end; CollectWindowWords estimates them otherwise
+				WParams.token_timestamps = !bIncrementalMel;
+				WParams.language = LanguageUtf8.c_str();
+				WParams.audio_ctx = AudioCtxPolicy.Apply(BgCtx, DecodeSamples);
+
+				// The committed transcript is the only context; whisper's own carry-over would repeat uncommitted text
+				WParams.no_context = true;
+				const int32 NumPromptTokens = FMath::Min(CommittedTokens.Num(), MaxPromptTokens);
+				WParams.prompt_tokens = NumPromptTokens > 0 ? CommittedTokens.GetData() + CommittedTokens.Num() - NumPromptTokens : nullptr;
+				WParams.prompt_n_tokens = NumPromptTokens;
+
+				// Use realtime flag as abort callback
+				WParams.abort_callback = [](void* UserData) -> bool
 				{
-					double Ratio = static_cast<double>(WHISPER_SAMPLE_RATE) / static_cast<double>(IntSampleRate);
-					int32 OutNumFrames = static_cast<int32>(NumFrames * Ratio);
-					ResampledData.SetNum(OutNumFrames);
+					TAtomic<bool>* Flag = static_cast<TAtomic<bool>*>(UserData);
+					return !(*Flag); // Abort if no longer in realtime mode
+				};
+				WParams.abort_callback_user_data = RealtimeFlag;
 
-					for (int32 i = 0; i < OutNumFrames; ++i)
+				// Short utterances are padded with silence up to the length whisper will decode
+				const int32 PaddedSamples = FMath::Max(DecodeSamples, MinWindowSamples);
+
+				const double DecodeStartTime = FPlatformTime::Seconds();
+				int Ret = 0;
+				if (bIncrementalMel)
+				{
+					// Only frames the window gained since the last tick are transformed; whisper skips its own
+					// front-end when given no samples and decodes the mel set here up to duration_ms
+					int32 NumMelFrames = 0;
+					MelStream.Build(Window, DecodeSamples, PaddedSamples, Gain, Mel, NumMelFrames);
+					UE_LOG(LogWhisperCpp, Verbose, TEXT("Whisper: Realtime mel — %d of %d frames computed in %.2f ms"),
+						MelStream.GetLastComputedFrames(), NumMelFrames, (FPlatformTime::Seconds() - DecodeStartTime) * 1000.0);
+
+					Ret = whisper_set_mel_with_state(BgCtx, State, Mel.GetData(), NumMelFrames, MelStream.GetNumMels());
+					if (Ret == 0)
 					{
-						double SrcIndex = static_cast<double>(i) / Ratio;
-						int32 Idx0 = static_cast<int32>(SrcIndex);
-						int32 Idx1 = FMath::Min(Idx0 + 1, NumFrames - 1);
-						double Frac = SrcIndex - static_cast<double>(Idx0);
-						ResampledData[i] = static_cast<float>(MonoData[Idx0] * (1.0 - Frac) + MonoData[Idx1] * Frac);
+						WParams.duration_ms = static_cast<int>(static_cast<int64>(PaddedSamples) * 1000 / WHISPER_SAMPLE_RATE);
+						Ret = whisper_full_with_state(BgCtx, State, WParams, nullptr, 0);
 					}
+					else
+					{
+						UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: whisper_set_mel failed with code %d"), Ret);
+					}
+				}
+				else
+				{
+					TArray<float> WindowInput(Window.GetData(), DecodeSamples);
+					for (float& Sample : WindowInput)
+					{
+						Sample *= Gain;
+					}
+					WindowInput.AddZeroed(PaddedSamples - DecodeSamples);
+					Ret = whisper_full_with_state(BgCtx, State, WParams, WindowInput.GetData(), WindowInput.Num());
+				}
+				UE_LOG(LogWhisperCpp, Verbose, TEXT("Whisper: Realtime pass over %.1fs took %.2fs (audio_ctx=%d)"),
+					static_cast<float>(PaddedSamples) / WHISPER_SAMPLE_RATE, FPlatformTime::Seconds() - DecodeStartTime, WParams.audio_ctx);
+
+				if (Ret != 0 || !*RealtimeFlag)
+				{
+					continue;
 				}
+
+				CollectWindowWords(BgCtx, State, Words);
 			}
 			else
 			{
-				ResampledData = MoveTemp(AudioSnapshot);
+				Words = MoveTemp(PreviousWords);
+				PreviousWords.Reset();
 			}
 
-			// Keep only last 30 seconds
-			if (ResampledData.Num() > MaxWindowSamples)
+			// Commit what this pass and the previous one agree on, but never the last word: speech may still run into it
+			int32 NumCommit = FMath::Min(CountAgreedWords(PreviousWords, Words), Words.Num() - 1);
+			const bool bWindowFull = Window.Num() >= MaxWindowSamples;
+			if (bWindowFull)
+			{
+				NumCommit = FMath::Max(NumCommit, Words.Num() - 1);
+			}
+			if (bUtteranceEnded)
 			{
-				int32 StartOffset = ResampledData.Num() - MaxWindowSamples;
-				TArray<float> Trimmed;
-				Trimmed.SetNum(MaxWindowSamples);
-				FMemory::Memcpy(Trimmed.GetData(), ResampledData.GetData() + StartOffset, MaxWindowSamples * sizeof(float));
-				ResampledData = MoveTemp(Trimmed);
+				NumCommit = Words.Num();
 			}
+			NumCommit = FMath::Max(NumCommit, 0);
 
-			// Normalize audio for whisper
+			const FString CommittedText = JoinWords(Words, 0, NumCommit);
+			int32 CommitSamples = 0;
+			if (NumCommit > 0)
 			{
-				float PeakAbs = 0.0f;
-				for (int32 i = 0; i < ResampledData.Num(); ++i)
+				for (int32 i = 0; i < NumCommit; ++i)
 				{
-					float Abs = FMath::Abs(ResampledData[i]);
-					if (Abs > PeakAbs) PeakAbs = Abs;
+					CommittedTokens.Append(Words[i].Tokens);
 				}
-				if (PeakAbs > 0.0f && PeakAbs < 0.5f)
+				const int64 EndSample = Words[NumCommit - 1].EndCentiseconds * WHISPER_SAMPLE_RATE / 100;
+				CommitSamples = static_cast<int32>(FMath::Clamp<int64>(EndSample, 0, Window.Num()));
+
+				// Estimated word ends are rough; cut in the quietest 20 ms within 150 ms of the estimate
+				if (bIncrementalMel && CommitSamples > 0)
 				{
-					float Gain = 0.9f / PeakAbs;
-					for (int32 i = 0; i < ResampledData.Num(); ++i)
-					{
-						ResampledData[i] *= Gain;
-					}
+					const int32 SnapSamples = WHISPER_SAMPLE_RATE * 15 / 100;
+					CommitSamples = FindQuietestSplit(Window.GetData(), FMath::Max(CommitSamples - SnapSamples, 0), FMath::Min(CommitSamples + SnapSamples, Window.Num()));
 				}
 			}
 
-			// Run whisper
-			whisper_full_params WParams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
-			WParams.n_threads = FMath::Clamp(NumThreads, 1, FPlatformMisc::NumberOfCoresIncludingHyperthreads());
-			WParams.print_progress = false;
-			WParams.print_special = false;
-			WParams.print_realtime = false;
-			WParams.print_timestamps = false;
-			WParams.single_segment = bUseSingleSegment;
-			WParams.no_timestamps = true;
-
-			std::string LanguageUtf8 = TCHAR_TO_UTF8(*Language);
-			WParams.language = LanguageUtf8.c_str();
-
-			// Use realtime flag as abort callback
-			WParams.abort_callback = [](void* UserData) -> bool
+			// A full window that still commits little (silence, or passes that never settle) drops its older half
+			if (bWindowFull && CommitSamples < Window.Num() - MaxWindowSamples / 2)
 			{
-				TAtomic<bool>* Flag = static_cast<TAtomic<bool>*>(UserData);
-				return !(*Flag); // Abort if no longer in realtime mode
-			};
-			WParams.abort_callback_user_data = RealtimeFlag;
-
-			int Ret = whisper_full(BgCtx, WParams, ResampledData.GetData(), ResampledData.Num());
+				CommitSamples = Window.Num() - MaxWindowSamples / 2;
+				Words.Reset();
+			}
 
-			if (Ret != 0 || !*RealtimeFlag)
+			FString EndedUtteranceText;
+			if (bUtteranceEnded)
 			{
-				continue;
+				CommitSamples = Window.Num();
+				EndedUtteranceText = (UtteranceText + TEXT(" ") + CommittedText).TrimStartAndEnd();
+				UtteranceText.Reset();
+				bInUtterance = false;
+			}
+			else if (bInUtterance && !CommittedText.IsEmpty())
+			{
+				UtteranceText = (UtteranceText + TEXT(" ") + CommittedText).TrimStartAndEnd();
 			}
 
-			// Extract full window text
-			FString WindowText;
-			int NSegments = whisper_full_n_segments(BgCtx);
-			for (int i = 0; i < NSegments; ++i)
+			Words.RemoveAt(0, FMath::Min(NumCommit, Words.Num()));
+			const FString TentativeText = JoinWords(Words, 0, Words.Num());
+
+			CommitSamples = DropFront(CommitSamples);
+			Swap(PreviousWords, Words);
+
+			// Keep the prompt history bounded for long sessions
+			if (CommittedTokens.Num() > 4 * MaxPromptTokens)
 			{
-				const char* SegText = whisper_full_get_segment_text(BgCtx, i);
-				WindowText += UTF8_TO_TCHAR(SegText);
+				CommittedTokens.RemoveAt(0, CommittedTokens.Num() - MaxPromptTokens);
 			}
 
-			WindowText = WindowText.TrimStartAndEnd();
+			UE_LOG(LogWhisperCpp, Verbose, TEXT("Whisper: Realtime pass — committed %d words, %.2fs of audio; window now %.2fs"),
+				NumCommit, static_cast<float>(CommitSamples) / WHISPER_SAMPLE_RATE, static_cast<float>(Window.Num()) / WHISPER_SAMPLE_RATE);
 
 			// Update AccumulatedTranscription and broadcast on game thread
 			// to avoid data race with StopRealtimeTranscription
-			if (!WindowText.IsEmpty())
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, CommittedText, TentativeText, bUtteranceStarted, bUtteranceEnded, EndedUtteranceText]()
 			{
-				FString NewWindowText = WindowText;
-				AsyncTask(ENamedThreads::GameThread, [WeakThis, NewWindowText]()
+				UWhisperCppTranscription* Self = WeakThis.Get();
+				if (!Self || !Self->bIsRealtimeTranscribing)
 				{
-					if (UWhisperCppTranscription* Self = WeakThis.Get())
-					{
-						FString DeltaText;
-
-						if (Self->LastWindowText.IsEmpty())
-						{
-							DeltaText = NewWindowText;
-						}
-						else if (NewWindowText.Len() > Self->LastWindowText.Len() && NewWindowText.StartsWith(Self->LastWindowText))
-						{
-							DeltaText = NewWindowText.Mid(Self->LastWindowText.Len()).TrimStartAndEnd();
-						}
-						else if (!NewWindowText.Equals(Self->LastWindowText))
-						{
-							DeltaText = NewWindowText;
-						}
+					return;
+				}
 
-						Self->LastWindowText = NewWindowText;
+				if (bUtteranceStarted)
+				{
+					Self->OnUtteranceStarted.Broadcast();
+				}
 
-						if (!DeltaText.IsEmpty())
-						{
-							if (!Self->AccumulatedTranscription.IsEmpty())
-							{
-								Self->AccumulatedTranscription += TEXT(" ");
-							}
-							Self->AccumulatedTranscription += DeltaText;
-							Self->OnPartialTranscription.Broadcast(DeltaText);
-						}
+				Self->PendingRealtimeText = TentativeText;
+				if (!CommittedText.IsEmpty())
+				{
+					if (!Self->AccumulatedTranscription.IsEmpty())
+					{
+						Self->AccumulatedTranscription += TEXT(" ");
 					}
-				});
-			}
-			else if (!WeakThis.IsValid())
-			{
-				break;
-			}
+					Self->AccumulatedTranscription += CommittedText;
+					Self->OnPartialTranscription.Broadcast(CommittedText);
+				}
+
+				if (bUtteranceEnded)
+				{
+					Self->OnUtteranceEnded.Broadcast(EndedUtteranceText);
+				}
+			});
 		}
 
+		Pool->Release(State);
 		DoneEvent->Trigger();
 	});
 }
 
 bool UWhisperCppTranscription::LoadWavFile(const FString& FilePath, TArray<float>& OutAudioData, int32& OutSampleRate, int32& OutNumChannels)
 {
-	TArray<uint8> FileData;
-	if (!FFileHelper::LoadFileToArray(FileData, *FilePath))
-	{
-		return false;
-	}
-
-	if (FileData.Num() < 44)
-	{
-		UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: WAV file too small"));
-		return false;
-	}
-
-	const uint8* Data = FileData.GetData();
-
-	// Verify RIFF header
-	if (Data[0] != 'R' || Data[1] != 'I' || Data[2] != 'F' || Data[3] != 'F')
+	FWhisperWavReader Reader;
+	if (!Reader.Open(FilePath))
 	{
-		UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: Not a valid RIFF file"));
 		return false;
 	}
 
-	// Verify WAVE format
-	if (Data[8] != 'W' || Data[9] != 'A' || Data[10] != 'V' || Data[11] != 'E')
+	const int64 NumSamples = Reader.GetNumFrames() * Reader.GetNumChannels();
+	if (NumSamples > MAX_int32)
 	{
-		UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: Not a valid WAVE file"));
+		UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: WAV file too long to load at once, use TranscribeLongWavFileAsync"));
 		return false;
 	}
 
-	// Parse fmt chunk — find it by scanning chunks
-	int32 Offset = 12;
-	int16 AudioFormat = 0;
-	int16 NumChannels = 0;
-	int32 SampleRate = 0;
-	int16 BitsPerSample = 0;
-
-	while (Offset + 8 <= FileData.Num())
-	{
-		const uint8* ChunkPtr = Data + Offset;
-		uint32 ChunkSize = *reinterpret_cast<const uint32*>(ChunkPtr + 4);
-
-		if (ChunkPtr[0] == 'f' && ChunkPtr[1] == 'm' && ChunkPtr[2] == 't' && ChunkPtr[3] == ' ')
-		{
-			if (Offset + 8 + 16 > FileData.Num())
-			{
-				return false;
-			}
-			AudioFormat = *reinterpret_cast<const int16*>(ChunkPtr + 8);
-			NumChannels = *reinterpret_cast<const int16*>(ChunkPtr + 10);
-			SampleRate = *reinterpret_cast<const int32*>(ChunkPtr + 12);
-			BitsPerSample = *reinterpret_cast<const int16*>(ChunkPtr + 22);
-		}
-		else if (ChunkPtr[0] == 'd' && ChunkPtr[1] == 'a' && ChunkPtr[2] == 't' && ChunkPtr[3] == 'a')
-		{
-			if (AudioFormat == 0)
-			{
-				UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: data chunk found before fmt chunk"));
-				return false;
-			}
-
-			const uint8* AudioDataPtr = ChunkPtr + 8;
-			int32 AudioDataSize = FMath::Min(static_cast<int32>(ChunkSize), FileData.Num() - (Offset + 8));
-
-			if (AudioFormat == 1 && BitsPerSample == 16) // PCM 16-bit
-			{
-				int32 NumSamples = AudioDataSize / 2;
-				OutAudioData.SetNum(NumSamples);
-				const int16* Samples16 = reinterpret_cast<const int16*>(AudioDataPtr);
-				for (int32 i = 0; i < NumSamples; ++i)
-				{
-					OutAudioData[i] = static_cast<float>(Samples16[i]) / 32768.0f;
-				}
-			}
-			else if (AudioFormat == 3 && BitsPerSample == 32) // IEEE float 32-bit
-			{
-				int32 NumSamples = AudioDataSize / 4;
-				OutAudioData.SetNum(NumSamples);
-				FMemory::Memcpy(OutAudioData.GetData(), AudioDataPtr, NumSamples * sizeof(float));
-			}
-			else
-			{
-				UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: Unsupported WAV format (format=%d, bits=%d)"), AudioFormat, BitsPerSample);
-				return false;
-			}
-
-			OutSampleRate = SampleRate;
-			OutNumChannels = NumChannels;
-			return true;
-		}
-
-		Offset += 8 + ChunkSize;
-		// Chunks are word-aligned
-		if (ChunkSize % 2 != 0)
-		{
-			Offset++;
-		}
-	}
+	OutAudioData.Reset(static_cast<int32>(NumSamples));
+	Reader.Read(static_cast<int32>(Reader.GetNumFrames()), OutAudioData);
 
-	UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: No data chunk found in WAV file"));
-	return false;
+	OutSampleRate = Reader.GetSampleRate();
+	OutNumChannels = Reader.GetNumChannels();
+	return true;
 }
-
-void UWhisperCppTranscription::ResampleTo16kMono(const TArray<float>& InData, int32 InSampleRate, int32 InNumChannels, TArray<float>& OutData)
-{
-	if (InData.Num() == 0 || InSampleRate <= 0 || InNumChannels <= 0)
-	{
-		return;
-	}
-
-	// First: downmix to mono if needed
-	TArray<float> MonoData;
-	int32 NumFrames = InData.Num() / InNumChannels;
-
-	if (InNumChannels > 1)
-	{
-		MonoData.SetNum(NumFrames);
-		for (int32 i = 0; i < NumFrames; ++i)
-		{
-			float Sum = 0.0f;
-			for (int32 c = 0; c < InNumChannels; ++c)
-			{
-				Sum += InData[i * InNumChannels + c];
-			}
-			MonoData[i] = Sum / static_cast<float>(InNumChannels);
-		}
-	}
-	else
-	{
-		MonoData = InData;
-	}
-
-	// Then: resample to 16kHz if needed
-	if (InSampleRate == WHISPER_SAMPLE_RATE)
-	{
-		OutData = MoveTemp(MonoData);
-		return;
-	}
-
-	double Ratio = static_cast<double>(WHISPER_SAMPLE_RATE) / static_cast<double>(InSampleRate);
-	int32 OutNumFrames = static_cast<int32>(NumFrames * Ratio);
-	OutData.SetNum(OutNumFrames);
-
-	for (int32 i = 0; i < OutNumFrames; ++i)
-	{
-		double SrcIndex = static_cast<double>(i) / Ratio;
-		int32 Idx0 = static_cast<int32>(SrcIndex);
-		int32 Idx1 = FMath::Min(Idx0 + 1, NumFrames - 1);
-		double Frac = SrcIndex - static_cast<double>(Idx0);
-
-		OutData[i] = static_cast<float>(MonoData[Idx0] * (1.0 - Frac) + MonoData[Idx1] * Frac);
-	}
-} 
\ No newline at end of file
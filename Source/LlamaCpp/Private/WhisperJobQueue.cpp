@@ -0,0 +1,92 @@
+#include "WhisperJobQueue.h"
+
+int32 FWhisperJobQueue::Enqueue(const FString& WavFilePath, const FWhisperTranscriptionOptions& Options, const TSharedRef<TAtomic<bool>, ESPMode::ThreadSafe>& CancelFlag)
+{
+	FScopeLock Lock(&QueueLock);
+	FWhisperQueuedJob& Job = Pending.AddDefaulted_GetRef();
+	Job.JobId = NextJobId++;
+	Job.WavFilePath = WavFilePath;
+	Job.Options = Options;
+	Job.CancelFlag = CancelFlag;
+	return Job.JobId;
+}
+
+bool FWhisperJobQueue::TryAddWorker(int32 MaxWorkers)
+{
+	FScopeLock Lock(&QueueLock);
+	if (NumWorkers >= FMath::Max(MaxWorkers, 1) || Pending.Num() == 0)
+	{
+		return false;
+	}
+
+	if (NumWorkers++ == 0)
+	{
+		BusyStartTime = FPlatformTime::Seconds();
+	}
+	return true;
+}
+
+bool FWhisperJobQueue::PopOrRetire(FWhisperQueuedJob& OutJob)
+{
+	FScopeLock Lock(&QueueLock);
+	if (Pending.Num() > 0)
+	{
+		// FIFO; the queue is short-lived and small next to a decode, so the shift is not worth a ring
+		OutJob = MoveTemp(Pending[0]);
+		Pending.RemoveAt(0);
+		return true;
+	}
+
+	if (--NumWorkers == 0)
+	{
+		BusySeconds += FPlatformTime::Seconds() - BusyStartTime;
+	}
+	return false;
+}
+
+void FWhisperJobQueue::RecordJob(bool bSuccess, double InAudioSeconds, double InDecodeSeconds)
+{
+	FScopeLock Lock(&QueueLock);
+	if (bSuccess)
+	{
+		++NumCompleted;
+		AudioSeconds += InAudioSeconds;
+		DecodeSeconds += InDecodeSeconds;
+	}
+	else
+	{
+		++NumFailed;
+	}
+}
+
+FWhisperQueueStats FWhisperJobQueue::GetStats() const
+{
+	FScopeLock Lock(&QueueLock);
+	FWhisperQueueStats Stats;
+	Stats.NumPending = Pending.Num();
+	Stats.NumWorkers = NumWorkers;
+	Stats.NumCompleted = NumCompleted;
+	Stats.NumFailed = NumFailed;
+	Stats.AudioSeconds = static_cast<float>(AudioSeconds);
+	Stats.DecodeSeconds = static_cast<float>(DecodeSeconds);
+
+	double WallSeconds = BusySeconds;
+	if (NumWorkers > 0)
+	{
+		WallSeconds += FPlatformTime::Seconds() - BusyStartTime;
+	}
+	Stats.WallSeconds = static_cast<float>(WallSeconds);
+	Stats.RealtimeFactor = WallSeconds > 0.0 ? static_cast<float>(AudioSeconds / WallSeconds) : 0.0f;
+	return Stats;
+}
+
+void FWhisperJobQueue::ResetStats()
+{
+	FScopeLock Lock(&QueueLock);
+	NumCompleted = 0;
+	NumFailed = 0;
+	AudioSeconds = 0.0;
+	DecodeSeconds = 0.0;
+	BusySeconds = 0.0;
+	BusyStartTime = FPlatformTime::Seconds();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WhisperCppTranscription.h"
+
+struct FWhisperQueuedJob
+{
+	int32 JobId = 0;
+	FString WavFilePath;
+	FWhisperTranscriptionOptions Options;
+	TSharedRef<TAtomic<bool>, ESPMode::ThreadSafe> CancelFlag = MakeShared<TAtomic<bool>, ESPMode::ThreadSafe>(false);
+};
+
+/**
+ * Pending files for UWhisperCppTranscription::EnqueueTranscription plus the bookkeeping of the workers
+ * draining them. Workers are plain threads that exit when the queue runs dry; popping the last job and
+ * retiring happen under one lock, so a job enqueued meanwhile is never left without a worker.
+ * Thread-safe.
+ */
+class FWhisperJobQueue
+{
+public:
+	/** Returns the new job's id. The job is failed without decoding once CancelFlag is set. */
+	int32 Enqueue(const FString& WavFilePath, const FWhisperTranscriptionOptions& Options, const TSharedRef<TAtomic<bool>, ESPMode::ThreadSafe>& CancelFlag);
+
+	/** Claim a worker slot. False if MaxWorkers are already running. */
+	bool TryAddWorker(int32 MaxWorkers);
+
+	/** Next job for a worker, or false after retiring the calling worker because nothing is left. */
+	bool PopOrRetire(FWhisperQueuedJob& OutJob);
+
+	void RecordJob(bool bSuccess, double AudioSeconds, double DecodeSeconds);
+
+	FWhisperQueueStats GetStats() const;
+	void ResetStats();
+
+private:
+	mutable FCriticalSection QueueLock;
+	TArray<FWhisperQueuedJob> Pending;
+	int32 NextJobId = 1;
+	int32 NumWorkers = 0;
+
+	int32 NumCompleted = 0;
+	int32 NumFailed = 0;
+	double AudioSeconds = 0.0;
+	double DecodeSeconds = 0.0;
+
+	/** Time with at least one worker running, excluding the current busy period. */
+	double BusySeconds = 0.0;
+	double BusyStartTime = 0.0;
+};
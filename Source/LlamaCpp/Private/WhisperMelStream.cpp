@@ -0,0 +1,298 @@
+#include "WhisperMelStream.h"
+#include "whisper.h"
+
+namespace
+{
+	/** Reflected lead-in whisper puts before the first sample, half an FFT frame. */
+	constexpr int32 MelLeadIn = WHISPER_N_FFT / 2;
+
+	/** log10 of the power floor, the value of a frame of pure silence. */
+	constexpr float MelSilence = -10.0f;
+
+	// Slaney mel scale, as used by librosa.filters.mel to generate whisper's filterbank
+	double HzToMel(double Hz)
+	{
+		const double MinLogHz = 1000.0;
+		const double MinLogMel = 15.0;
+		const double LogStep = FMath::Loge(6.4) / 27.0;
+		return Hz < MinLogHz ? Hz * 3.0 / 200.0 : MinLogMel + FMath::Loge(Hz / MinLogHz) / LogStep;
+	}
+
+	double MelToHz(double Mel)
+	{
+		const double MinLogHz = 1000.0;
+		const double MinLogMel = 15.0;
+		const double LogStep = FMath::Loge(6.4) / 27.0;
+		return Mel < MinLogMel ? Mel * 200.0 / 3.0 : MinLogHz * FMath::Exp(LogStep * (Mel - MinLogMel));
+	}
+}
+
+void FWhisperMelStream::Init(int32 InNumMels, int32 InitialCapacityFrames)
+{
+	NumMels = FMath::Max(InNumMels, 1);
+	NumBins = WHISPER_N_FFT / 2 + 1;
+
+	// Triangular filters between NumMels + 2 points evenly spaced in mel, area-normalized (Slaney)
+	TArray<double> MelPointsHz;
+	MelPointsHz.SetNumUninitialized(NumMels + 2);
+	const double MaxMel = HzToMel(WHISPER_SAMPLE_RATE / 2.0);
+	for (int32 i = 0; i < NumMels + 2; ++i)
+	{
+		MelPointsHz[i] = MelToHz(MaxMel * i / (NumMels + 1));
+	}
+
+	Filters.SetNumZeroed(NumMels * NumBins);
+	for (int32 m = 0; m < NumMels; ++m)
+	{
+		const double Lower = MelPointsHz[m];
+		const double Centre = MelPointsHz[m + 1];
+		const double Upper = MelPointsHz[m + 2];
+		const double Norm = 2.0 / (Upper - Lower);
+		for (int32 k = 0; k < NumBins; ++k)
+		{
+			const double Hz = static_cast<double>(k) * WHISPER_SAMPLE_RATE / WHISPER_N_FFT;
+			const double Weight = FMath::Min((Hz - Lower) / (Centre - Lower), (Upper - Hz) / (Upper - Centre));
+			Filters[m * NumBins + k] = static_cast<float>(FMath::Max(Weight, 0.0) * Norm);
+		}
+	}
+
+	// Periodic Hann window, and one table of twiddles every sub-FFT size indexes into
+	HannWindow.SetNumUninitialized(WHISPER_N_FFT);
+	CosTable.SetNumUninitialized(WHISPER_N_FFT);
+	SinTable.SetNumUninitialized(WHISPER_N_FFT);
+	for (int32 i = 0; i < WHISPER_N_FFT; ++i)
+	{
+		const double Angle = 2.0 * UE_DOUBLE_PI * i / WHISPER_N_FFT;
+		HannWindow[i] = static_cast<float>(0.5 * (1.0 - FMath::Cos(Angle)));
+		CosTable[i] = static_cast<float>(FMath::Cos(Angle));
+		SinTable[i] = static_cast<float>(FMath::Sin(Angle));
+	}
+
+	// The recursive FFT uses the space after its input and output as scratch
+	FftIn.SetNumZeroed(WHISPER_N_FFT * 2);
+	FftOut.SetNumZeroed(WHISPER_N_FFT * 8);
+	Power.SetNumZeroed(NumBins);
+
+	Capacity = FMath::Max(InitialCapacityFrames, 16);
+	Ring.SetNumUninitialized(Capacity * NumMels);
+	Reset();
+}
+
+void FWhisperMelStream::Reset()
+{
+	Head = 0;
+	Count = 0;
+	bHeadDirty = false;
+	LastComputedFrames = 0;
+}
+
+void FWhisperMelStream::Discard(int32 NumSamples)
+{
+	check(NumSamples % WHISPER_HOP_LENGTH == 0);
+	const int32 NumFrames = NumSamples / WHISPER_HOP_LENGTH;
+	if (NumFrames <= 0)
+	{
+		return;
+	}
+
+	if (NumFrames >= Count)
+	{
+		Head = 0;
+		Count = 0;
+		bHeadDirty = false;
+		return;
+	}
+
+	Head = (Head + NumFrames) % Capacity;
+	Count -= NumFrames;
+	bHeadDirty = true;
+}
+
+void FWhisperMelStream::Grow()
+{
+	TArray<float> Linear;
+	Linear.SetNumUninitialized(Capacity * 2 * NumMels);
+	for (int32 i = 0; i < Count; ++i)
+	{
+		FMemory::Memcpy(Linear.GetData() + i * NumMels, CachedFrame(i), NumMels * sizeof(float));
+	}
+	Ring = MoveTemp(Linear);
+	Capacity *= 2;
+	Head = 0;
+}
+
+void FWhisperMelStream::Build(const TArray<float>& Window, int32 NumSamples, int32 PaddedSamples, float Gain, TArray<float>& OutMel, int32& OutNumFrames)
+{
+	LastComputedFrames = 0;
+	NumSamples = FMath::Clamp(NumSamples, 0, Window.Num());
+	PaddedSamples = FMath::Max(PaddedSamples, NumSamples);
+
+	// Frame i covers samples [i * hop - lead-in, i * hop + lead-in); cache every frame the window fully covers
+	const int32 NumCoveredFrames = Window.Num() >= MelLeadIn ? (Window.Num() - MelLeadIn) / WHISPER_HOP_LENGTH + 1 : 0;
+	if (bHeadDirty)
+	{
+		for (int32 i = 0; i < FMath::Min(Count, 2); ++i)
+		{
+			ComputeFrame(Window.GetData(), Window.Num(), i, CachedFrame(i));
+			++LastComputedFrames;
+		}
+		bHeadDirty = false;
+	}
+	while (Count < NumCoveredFrames)
+	{
+		if (Count == Capacity)
+		{
+			Grow();
+		}
+		ComputeFrame(Window.GetData(), Window.Num(), Count, CachedFrame(Count));
+		++Count;
+		++LastComputedFrames;
+	}
+
+	// Same length whisper_pcm_to_mel produces: the clip plus 30 s of silence
+	OutNumFrames = (PaddedSamples + WHISPER_CHUNK_SIZE * WHISPER_SAMPLE_RATE) / WHISPER_HOP_LENGTH;
+	OutMel.SetNumUninitialized(OutNumFrames * NumMels);
+
+	// Gain on the samples is a constant offset on log10 power
+	const float GainOffset = Gain > 0.0f ? 2.0f * FMath::LogX(10.0f, Gain) : 0.0f;
+
+	TArray<float> Frame;
+	Frame.SetNumUninitialized(NumMels);
+	float MaxValue = MelSilence;
+	for (int32 i = 0; i < OutNumFrames; ++i)
+	{
+		const float* Values = nullptr;
+		const int32 FrameEnd = i * WHISPER_HOP_LENGTH + MelLeadIn;
+		const int32 FrameStart = FrameEnd - WHISPER_N_FFT;
+		if (FrameStart >= NumSamples)
+		{
+			// Only the silence after the clip
+			for (int32 m = 0; m < NumMels; ++m)
+			{
+				OutMel[m * OutNumFrames + i] = MelSilence;
+			}
+			continue;
+		}
+
+		if (i < Count && FrameEnd <= NumSamples)
+		{
+			Values = CachedFrame(i);
+		}
+		else
+		{
+			// Runs past the clip (VAD may end it mid-window); zeros after NumSamples as whisper pads them
+			ComputeFrame(Window.GetData(), NumSamples, i, Frame.GetData());
+			Values = Frame.GetData();
+			++LastComputedFrames;
+		}
+
+		for (int32 m = 0; m < NumMels; ++m)
+		{
+			const float Value = Values[m] > MelSilence ? Values[m] + GainOffset : MelSilence;
+			OutMel[m * OutNumFrames + i] = Value;
+			MaxValue = FMath::Max(MaxValue, Value);
+		}
+	}
+
+	// whisper's normalization: clamp to 8 decades below the peak, then scale to roughly [-1, 1]
+	const float Floor = MaxValue - 8.0f;
+	for (float& Value : OutMel)
+	{
+		Value = (FMath::Max(Value, Floor) + 4.0f) / 4.0f;
+	}
+}
+
+void FWhisperMelStream::ComputeFrame(const float* Samples, int32 NumSamples, int32 FrameIndex, float* OutFrame)
+{
+	const int32 Start = FrameIndex * WHISPER_HOP_LENGTH - MelLeadIn;
+	for (int32 n = 0; n < WHISPER_N_FFT; ++n)
+	{
+		// Before the first sample whisper mirrors the audio (sample -s is sample s)
+		const int32 s = FMath::Abs(Start + n);
+		FftIn[n] = s < NumSamples ? Samples[s] * HannWindow[n] : 0.0f;
+	}
+
+	Fft(FftIn.GetData(), WHISPER_N_FFT, FftOut.GetData());
+
+	for (int32 k = 0; k < NumBins; ++k)
+	{
+		Power[k] = FftOut[2 * k] * FftOut[2 * k] + FftOut[2 * k + 1] * FftOut[2 * k + 1];
+	}
+
+	for (int32 m = 0; m < NumMels; ++m)
+	{
+		const float* Weights = Filters.GetData() + m * NumBins;
+		double Sum = 0.0;
+		for (int32 k = 0; k < NumBins; ++k)
+		{
+			Sum += Power[k] * Weights[k];
+		}
+		OutFrame[m] = static_cast<float>(FMath::LogX(10.0, FMath::Max(Sum, 1e-10)));
+	}
+}
+
+void FWhisperMelStream::Fft(float* In, int32 N, float* Out)
+{
+	// Radix-2 down to an odd size (400 -> 25), then a direct DFT, like whisper's own front-end
+	if (N == 1)
+	{
+		Out[0] = In[0];
+		Out[1] = 0.0f;
+		return;
+	}
+
+	const int32 HalfN = N / 2;
+	if (N % 2 == 1)
+	{
+		Dft(In, N, Out);
+		return;
+	}
+
+	float* Even = In + N;
+	for (int32 i = 0; i < HalfN; ++i)
+	{
+		Even[i] = In[2 * i];
+	}
+	float* EvenFft = Out + 2 * N;
+	Fft(Even, HalfN, EvenFft);
+
+	float* Odd = Even;
+	for (int32 i = 0; i < HalfN; ++i)
+	{
+		Odd[i] = In[2 * i + 1];
+	}
+	float* OddFft = EvenFft + N;
+	Fft(Odd, HalfN, OddFft);
+
+	const int32 Step = WHISPER_N_FFT / N;
+	for (int32 k = 0; k < HalfN; ++k)
+	{
+		const float Re = CosTable[k * Step];
+		const float Im = -SinTable[k * Step];
+		const float ReOdd = OddFft[2 * k];
+		const float ImOdd = OddFft[2 * k + 1];
+
+		Out[2 * k] = EvenFft[2 * k] + Re * ReOdd - Im * ImOdd;
+		Out[2 * k + 1] = EvenFft[2 * k + 1] + Re * ImOdd + Im * ReOdd;
+		Out[2 * (k + HalfN)] = EvenFft[2 * k] - Re * ReOdd + Im * ImOdd;
+		Out[2 * (k + HalfN) + 1] = EvenFft[2 * k + 1] - Re * ImOdd - Im * ReOdd;
+	}
+}
+
+void FWhisperMelStream::Dft(const float* In, int32 N, float* Out) const
+{
+	const int32 Step = WHISPER_N_FFT / N;
+	for (int32 k = 0; k < N; ++k)
+	{
+		float Re = 0.0f;
+		float Im = 0.0f;
+		for (int32 n = 0; n < N; ++n)
+		{
+			const int32 Index = (k * n * Step) % WHISPER_N_FFT;
+			Re += In[n] * CosTable[Index];
+			Im -= In[n] * SinTable[Index];
+		}
+		Out[2 * k] = Re;
+		Out[2 * k + 1] = Im;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Whisper's log-mel front-end (400-point Hann-windowed FFT, 160-sample hop, Slaney mel filterbank)
+ * computed incrementally over a growing audio window. Frames whose 400 samples are all available are
+ * cached in a ring; when the window grows only the new frames are transformed, and when it is trimmed
+ * at the front the cache shifts along. Build assembles the normalized spectrogram whisper expects from
+ * whisper_set_mel_with_state, matching whisper_pcm_to_mel on the same samples (up to float rounding).
+ * Not thread-safe; use one per stream.
+ */
+class FWhisperMelStream
+{
+public:
+	/** Build the filterbank for the model's mel bin count and drop any cached frames. */
+	void Init(int32 InNumMels, int32 InitialCapacityFrames);
+
+	/** Forget all cached frames. */
+	void Reset();
+
+	/** The window lost NumSamples from its front. NumSamples must be a multiple of WHISPER_HOP_LENGTH. */
+	void Discard(int32 NumSamples);
+
+	/**
+	 * Normalized log-mel of Window[0, NumSamples) followed by silence up to PaddedSamples, plus whisper's
+	 * 30 s of trailing silence, laid out as NumMels rows of OutNumFrames. Gain scales the audio as if it
+	 * had been applied to the samples. Computes and caches any frames Window now covers first.
+	 */
+	void Build(const TArray<float>& Window, int32 NumSamples, int32 PaddedSamples, float Gain, TArray<float>& OutMel, int32& OutNumFrames);
+
+	int32 GetNumMels() const { return NumMels; }
+
+	/** Frames transformed by the last Build; the rest came from the cache. */
+	int32 GetLastComputedFrames() const { return LastComputedFrames; }
+
+private:
+	int32 NumMels = 0;
+	int32 NumBins = 0;
+
+	TArray<float> Filters;      // NumMels rows of NumBins weights
+	TArray<float> HannWindow;
+	TArray<float> CosTable;     // cos/sin of 2*pi*i/WHISPER_N_FFT; every sub-FFT size divides WHISPER_N_FFT
+	TArray<float> SinTable;
+	TArray<float> FftIn;
+	TArray<float> FftOut;
+	TArray<float> Power;
+
+	/** Cached raw log10 frames, NumMels values each, oldest at Head. */
+	TArray<float> Ring;
+	int32 Capacity = 0;
+	int32 Head = 0;
+	int32 Count = 0;
+
+	/** The first two frames overlap the reflected lead-in, which changes whenever the window start moves. */
+	bool bHeadDirty = false;
+
+	int32 LastComputedFrames = 0;
+
+	float* CachedFrame(int32 Index) { return Ring.GetData() + ((Head + Index) % Capacity) * NumMels; }
+	void Grow();
+
+	/** Raw log10 mel energies of frame FrameIndex over Samples[0, NumSamples), zeros past the end. */
+	void ComputeFrame(const float* Samples, int32 NumSamples, int32 FrameIndex, float* OutFrame);
+
+	void Fft(float* In, int32 N, float* Out);
+	void Dft(const float* In, int32 N, float* Out) const;
+};
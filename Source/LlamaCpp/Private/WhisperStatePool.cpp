@@ -0,0 +1,89 @@
+#include "WhisperStatePool.h"
+#include "whisper.h"
+#include "LlamaCppLog.h"
+
+FWhisperStatePool::FWhisperStatePool(whisper_context* InCtx, int32 InMaxStates)
+	: Ctx(InCtx)
+	, MaxStates(FMath::Max(InMaxStates, 1))
+{
+	StateReleasedEvent = FPlatformProcess::GetSynchEventFromPool(false);
+}
+
+FWhisperStatePool::~FWhisperStatePool()
+{
+	ensureMsgf(NumInUse == 0, TEXT("Whisper state pool destroyed with %d states still in use"), NumInUse);
+
+	for (whisper_state* State : Idle)
+	{
+		whisper_free_state(State);
+	}
+	Idle.Empty();
+
+	FPlatformProcess::ReturnSynchEventToPool(StateReleasedEvent);
+	StateReleasedEvent = nullptr;
+}
+
+whisper_state* FWhisperStatePool::AcquireLocked(bool& bOutMustWait)
+{
+	bOutMustWait = false;
+	if (Idle.Num() > 0)
+	{
+		++NumInUse;
+		return Idle.Pop();
+	}
+
+	if (NumCreated >= MaxStates)
+	{
+		bOutMustWait = true;
+		return nullptr;
+	}
+
+	// Each state holds its own KV caches and compute buffers; creating one is the expensive part
+	whisper_state* State = whisper_init_state(Ctx);
+	if (!State)
+	{
+		UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: Failed to create decoder state (%d already created)"), NumCreated);
+		return nullptr;
+	}
+
+	++NumCreated;
+	++NumInUse;
+	UE_LOG(LogWhisperCpp, Verbose, TEXT("Whisper: Created decoder state %d/%d"), NumCreated, MaxStates);
+	return State;
+}
+
+whisper_state* FWhisperStatePool::Acquire(const TAtomic<bool>* CancelFlag)
+{
+	for (;;)
+	{
+		bool bMustWait = false;
+		{
+			FScopeLock Lock(&PoolLock);
+			whisper_state* State = AcquireLocked(bMustWait);
+			if (!bMustWait)
+			{
+				return State;
+			}
+		}
+		if (CancelFlag && *CancelFlag)
+		{
+			return nullptr;
+		}
+		StateReleasedEvent->Wait(10);
+	}
+}
+
+void FWhisperStatePool::Release(whisper_state* State)
+{
+	if (!State)
+	{
+		return;
+	}
+
+	{
+		FScopeLock Lock(&PoolLock);
+		--NumInUse;
+		Idle.Add(State);
+	}
+	StateReleasedEvent->Trigger();
+}
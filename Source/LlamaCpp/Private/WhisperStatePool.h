@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct whisper_context;
+struct whisper_state;
+
+/**
+ * Decoder states sharing one set of whisper weights. A context loaded with
+ * whisper_init_from_file_with_params_no_state holds only the model; every concurrent transcription
+ * borrows its own whisper_state (KV caches, mel buffer, results) from here and runs through
+ * whisper_full_with_state. States are created on demand up to MaxStates and reused afterwards.
+ * Thread-safe.
+ */
+class FWhisperStatePool
+{
+public:
+	FWhisperStatePool(whisper_context* InCtx, int32 InMaxStates);
+
+	/** All borrowed states must have been released. */
+	~FWhisperStatePool();
+
+	/**
+	 * Borrow a state, creating one if under the limit and waiting for a release otherwise. Null if creation
+	 * failed, or if CancelFlag is set while waiting.
+	 */
+	whisper_state* Acquire(const TAtomic<bool>* CancelFlag = nullptr);
+
+	void Release(whisper_state* State);
+
+private:
+	whisper_context* Ctx = nullptr;
+	int32 MaxStates = 1;
+	int32 NumCreated = 0;
+	int32 NumInUse = 0;
+	TArray<whisper_state*> Idle;
+
+	FCriticalSection PoolLock;
+	FEvent* StateReleasedEvent = nullptr;
+
+	whisper_state* AcquireLocked(bool& bOutMustWait);
+};
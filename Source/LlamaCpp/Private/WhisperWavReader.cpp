@@ -0,0 +1,134 @@
+#include "WhisperWavReader.h"
+#include "LlamaCppLog.h"
+
+bool FWhisperWavReader::Open(const FString& FilePath)
+{
+	File.Reset(IFileManager::Get().CreateFileReader(*FilePath));
+	if (!File)
+	{
+		return false;
+	}
+
+	const int64 FileSize = File->TotalSize();
+	if (FileSize < 44)
+	{
+		UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: WAV file too small"));
+		return false;
+	}
+
+	uint8 Header[12];
+	File->Serialize(Header, sizeof(Header));
+
+	// Verify RIFF header
+	if (Header[0] != 'R' || Header[1] != 'I' || Header[2] != 'F' || Header[3] != 'F')
+	{
+		UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: Not a valid RIFF file"));
+		return false;
+	}
+
+	// Verify WAVE format
+	if (Header[8] != 'W' || Header[9] != 'A' || Header[10] != 'V' || Header[11] != 'E')
+	{
+		UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: Not a valid WAVE file"));
+		return false;
+	}
+
+	// Scan chunks for fmt and data
+	int64 Offset = 12;
+	while (Offset + 8 <= FileSize)
+	{
+		uint8 ChunkHeader[8];
+		File->Seek(Offset);
+		File->Serialize(ChunkHeader, sizeof(ChunkHeader));
+		const uint32 ChunkSize = *reinterpret_cast<const uint32*>(ChunkHeader + 4);
+
+		if (ChunkHeader[0] == 'f' && ChunkHeader[1] == 'm' && ChunkHeader[2] == 't' && ChunkHeader[3] == ' ')
+		{
+			if (Offset + 8 + 16 > FileSize)
+			{
+				return false;
+			}
+			uint8 Fmt[16];
+			File->Serialize(Fmt, sizeof(Fmt));
+			AudioFormat = *reinterpret_cast<const int16*>(Fmt + 0);
+			NumChannels = *reinterpret_cast<const int16*>(Fmt + 2);
+			SampleRate = *reinterpret_cast<const int32*>(Fmt + 4);
+			BitsPerSample = *reinterpret_cast<const int16*>(Fmt + 14);
+		}
+		else if (ChunkHeader[0] == 'd' && ChunkHeader[1] == 'a' && ChunkHeader[2] == 't' && ChunkHeader[3] == 'a')
+		{
+			if (AudioFormat == 0)
+			{
+				UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: data chunk found before fmt chunk"));
+				return false;
+			}
+
+			const bool bPcm16 = AudioFormat == 1 && BitsPerSample == 16;
+			const bool bFloat32 = AudioFormat == 3 && BitsPerSample == 32;
+			if (!bPcm16 && !bFloat32)
+			{
+				UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: Unsupported WAV format (format=%d, bits=%d)"), AudioFormat, BitsPerSample);
+				return false;
+			}
+
+			if (NumChannels <= 0 || SampleRate <= 0)
+			{
+				UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: Invalid WAV format (channels=%d, rate=%d)"), NumChannels, SampleRate);
+				return false;
+			}
+
+			// Truncated files are common (recorders killed mid-write); read what is there
+			const int64 Available = FMath::Min<int64>(ChunkSize, FileSize - (Offset + 8));
+			DataBytes = Available - Available % FrameBytes();
+			DataBytesRead = 0;
+			return true;
+		}
+
+		Offset += 8 + ChunkSize;
+		// Chunks are word-aligned
+		if (ChunkSize % 2 != 0)
+		{
+			Offset++;
+		}
+	}
+
+	UE_LOG(LogWhisperCpp, Error, TEXT("Whisper: No data chunk found in WAV file"));
+	return false;
+}
+
+int32 FWhisperWavReader::Read(int32 MaxFrames, TArray<float>& Out)
+{
+	if (!File || MaxFrames <= 0)
+	{
+		return 0;
+	}
+
+	const int64 BytesLeft = DataBytes - DataBytesRead;
+	const int32 NumFrames = static_cast<int32>(FMath::Min<int64>(MaxFrames, BytesLeft / FrameBytes()));
+	if (NumFrames <= 0)
+	{
+		return 0;
+	}
+
+	const int32 NumSamples = NumFrames * NumChannels;
+	const int32 Start = Out.AddUninitialized(NumSamples);
+	float* Dst = Out.GetData() + Start;
+
+	if (BitsPerSample == 32) // IEEE float 32-bit
+	{
+		File->Serialize(Dst, NumSamples * sizeof(float));
+	}
+	else // PCM 16-bit
+	{
+		Scratch.SetNumUninitialized(NumSamples * sizeof(int16), EAllowShrinking::No);
+		File->Serialize(Scratch.GetData(), Scratch.Num());
+		const int16* Samples16 = reinterpret_cast<const int16*>(Scratch.GetData());
+		for (int32 i = 0; i < NumSamples; ++i)
+		{
+			Dst[i] = static_cast<float>(Samples16[i]) / 32768.0f;
+		}
+	}
+
+	DataBytesRead += static_cast<int64>(NumFrames) * FrameBytes();
+	return NumFrames;
+}
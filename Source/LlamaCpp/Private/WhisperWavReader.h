@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/FileManager.h"
+
+/**
+ * Reads the sample data of a RIFF/WAVE file a block at a time, so long recordings never have to be
+ * in memory at once. Supports 16-bit PCM and 32-bit float, any rate and channel count.
+ */
+class FWhisperWavReader
+{
+public:
+	/** Parse the header and position at the start of the data chunk. Logs and returns false on anything unsupported. */
+	bool Open(const FString& FilePath);
+
+	/** Append up to MaxFrames interleaved frames to Out as float. Returns frames read; 0 at the end of the data. */
+	int32 Read(int32 MaxFrames, TArray<float>& Out);
+
+	int32 GetSampleRate() const { return SampleRate; }
+	int32 GetNumChannels() const { return NumChannels; }
+	int64 GetNumFrames() const { return DataBytes / FrameBytes(); }
+
+private:
+	TUniquePtr<FArchive> File;
+	int16 AudioFormat = 0;
+	int16 BitsPerSample = 0;
+	int32 SampleRate = 0;
+	int32 NumChannels = 0;
+	int64 DataBytes = 0;
+	int64 DataBytesRead = 0;
+	TArray<uint8> Scratch;
+
+	int32 FrameBytes() const { return FMath::Max(NumChannels * (BitsPerSample / 8), 1); }
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include <string>
+#include "LlamaConversation.generated.h"
+
+USTRUCT(BlueprintType)
+struct FLlamaChatMessage
+{
+	GENERATED_BODY()
+
+	/** "system", "user" or "assistant". */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	FString Role;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	FString Content;
+};
+
+/**
+ * Chat history formatted with the model's chat template (llama_chat_apply_template).
+ *
+ * The formatted history and its tokens are cached. When messages are only appended, just the new
+ * part of the formatted text is tokenized, so long histories are not re-tokenized every turn.
+ * Any other edit falls back to a full re-tokenization on the next BuildPromptTokens.
+ *
+ * Pass to ULlamaCppInference::GenerateConversationAsync, which also reuses the KV cache for the
+ * unchanged prefix. Game thread only.
+ */
+UCLASS(BlueprintType, Blueprintable)
+class LLAMACPP_API ULlamaConversation : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Built-in template name (e.g. "chatml", "llama3") or template source. Empty uses the model's own template. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	FString ChatTemplate;
+
+	/** Set or replace the leading system message. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void SetSystemPrompt(const FString& SystemPrompt);
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void AddMessage(const FString& Role, const FString& Content);
+
+	/** Remove the newest message, e.g. to regenerate a reply. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void RemoveLastMessage();
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void Clear(bool bKeepSystemPrompt = true);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
+	TArray<FLlamaChatMessage> GetMessages() const { return Messages; }
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
+	int32 NumMessages() const { return Messages.Num(); }
+
+	/**
+	 * Tokens for the whole history followed by the assistant prefix, ready to generate the next reply.
+	 * Returns false if the template cannot be applied or tokenization fails.
+	 */
+	bool BuildPromptTokens(const struct llama_model* Model, TArray<int32>& OutTokens);
+
+	/**
+	 * Tokens for the history followed by a message that is not stored (e.g. a partial player line),
+	 * without the assistant prefix. Used for speculative prefill; the cached history stays valid.
+	 */
+	bool BuildPendingTokens(const struct llama_model* Model, const FString& Role, const FString& Content, TArray<int32>& OutTokens);
+
+	/** Format the first NumMessages messages (all if negative) with the template for Model. */
+	bool FormatMessages(const struct llama_model* Model, int32 NumMessages, bool bAddAssistantPrefix, std::string& OutText) const;
+
+private:
+	TArray<FLlamaChatMessage> Messages;
+
+	// Formatted history (without assistant prefix) and its tokens, as of the last BuildPromptTokens
+	const struct llama_model* CachedModel = nullptr;
+	FString CachedTemplate;
+	std::string CachedText;
+	TArray<int32> CachedTokens;
+
+	void InvalidateCache();
+
+	/** Format the stored history and bring CachedTokens up to date with it. */
+	bool UpdateCachedTokens(const struct llama_model* Model, std::string& OutHistory);
+
+	/** CachedTokens plus the tokens of Full past History, or all of Full re-tokenized if it does not extend History. */
+	bool AppendFormattedTail(const struct llama_model* Model, const std::string& History, const std::string& Full, TArray<int32>& OutTokens) const;
+};
@@ -5,6 +5,12 @@
 #include "LlamaCppBlueprintLibrary.generated.h"
 
 class ULlamaCppInference;
+class ULlamaCppEmbedder;
+class ULlamaCppVectorStore;
+class ULlamaCppSemanticCache;
+class ULlamaConversation;
+class ULlamaCppRouter;
+class ULlamaCppLogitFilter;
 class UWhisperCppTranscription;
 class USherpaOnnxTextToSpeech;
 class USherpaOnnxTranscription;
@@ -18,6 +24,24 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "LlamaCpp", meta = (WorldContext = "WorldContextObject"))
 	static ULlamaCppInference* CreateLlamaCppInference(UObject* WorldContextObject);
 
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp", meta = (WorldContext = "WorldContextObject"))
+	static ULlamaCppEmbedder* CreateLlamaCppEmbedder(UObject* WorldContextObject);
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp", meta = (WorldContext = "WorldContextObject"))
+	static ULlamaCppVectorStore* CreateLlamaCppVectorStore(UObject* WorldContextObject);
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp", meta = (WorldContext = "WorldContextObject"))
+	static ULlamaCppSemanticCache* CreateLlamaCppSemanticCache(UObject* WorldContextObject);
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp", meta = (WorldContext = "WorldContextObject"))
+	static ULlamaConversation* CreateLlamaConversation(UObject* WorldContextObject);
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp", meta = (WorldContext = "WorldContextObject"))
+	static ULlamaCppRouter* CreateLlamaCppRouter(UObject* WorldContextObject);
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp", meta = (WorldContext = "WorldContextObject"))
+	static ULlamaCppLogitFilter* CreateLlamaCppLogitFilter(UObject* WorldContextObject);
+
 	UFUNCTION(BlueprintCallable, Category = "Whisper", meta = (WorldContext = "WorldContextObject"))
 	static UWhisperCppTranscription* CreateWhisperTranscription(UObject* WorldContextObject);
 
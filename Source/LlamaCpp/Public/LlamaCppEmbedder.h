@@ -0,0 +1,146 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "LlamaCppEmbedder.generated.h"
+
+UENUM(BlueprintType)
+enum class ELlamaPoolingType : uint8
+{
+	/** Use the pooling type stored in the model file. */
+	FromModel,
+	Mean,
+	Cls,
+	Last,
+	/** Classification head output (llama_model_n_cls_out scores); required for Classify. */
+	Rank
+};
+
+USTRUCT(BlueprintType)
+struct FLlamaEmbedding
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	TArray<float> Vector;
+};
+
+USTRUCT(BlueprintType)
+struct FLlamaClassLabel
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	FString Label;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	float Probability = 0.0f;
+};
+
+USTRUCT(BlueprintType)
+struct FLlamaClassification
+{
+	GENERATED_BODY()
+
+	/** One entry per classifier output, in model order. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	TArray<FLlamaClassLabel> Labels;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 BestIndex = INDEX_NONE;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnEmbedderModelLoaded, bool, bSuccess);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnEmbeddingsComputed, const TArray<FLlamaEmbedding>&, Embeddings);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnTextsClassified, const TArray<FLlamaClassification>&, Results);
+
+UCLASS(BlueprintType, Blueprintable)
+class LLAMACPP_API ULlamaCppEmbedder : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	ULlamaCppEmbedder();
+	virtual void BeginDestroy() override;
+
+	/** Load an embedding model. ContextSize is also the batch size, so it bounds the total tokens encoded per decode. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void LoadModel(const FString& ModelPath, int32 ContextSize = 2048, ELlamaPoolingType PoolingType = ELlamaPoolingType::FromModel);
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void UnloadModel();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
+	bool IsModelLoaded() const;
+
+	/** Vector size returned by Embed; for Rank pooling this is the number of classifier outputs. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
+	int32 GetEmbeddingSize() const;
+
+	/** Hash of the loaded model's file name, description, size and pooling; vectors are only comparable when it matches. 0 if none is loaded. */
+	uint64 GetModelIdentity() const { return ModelIdentity; }
+
+	/** Embed all texts on a background thread. Texts are packed into as few batches as possible, one sequence per text. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void EmbedAsync(const TArray<FString>& Texts);
+
+	/**
+	 * Embed texts on the calling thread. Safe to call from any thread; calls are serialized on the model's context.
+	 * Returns false if no model is loaded or decoding failed.
+	 */
+	bool EmbedBlocking(const TArray<FString>& Texts, TArray<TArray<float>>& OutVectors);
+
+	/**
+	 * Classify one text with a model that has a classification head (load with Rank pooling).
+	 * Label probabilities are a softmax over the head's outputs, or a sigmoid for a single output.
+	 * Results fire via OnTextsClassified.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void ClassifyAsync(const FString& Text);
+
+	/** Classify several texts in as few encoder passes as possible. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void ClassifyBatchAsync(const TArray<FString>& Texts);
+
+	/** Classify on the calling thread. Returns false if no Rank-pooled model is loaded or decoding failed. */
+	bool ClassifyBlocking(const TArray<FString>& Texts, TArray<FLlamaClassification>& OutResults);
+
+	/** Labels of the classification head (llama_model_cls_label), empty unless a Rank-pooled model is loaded. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
+	TArray<FString> GetClassLabels() const { return ClassLabels; }
+
+	/** Maximum number of texts packed into one batch. Applied on LoadModel. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 MaxParallelSequences = 16;
+
+	/** L2-normalize the output vectors so a dot product equals cosine similarity. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	bool bNormalize = true;
+
+	UPROPERTY(BlueprintAssignable, Category = "LlamaCpp")
+	FOnEmbedderModelLoaded OnModelLoaded;
+
+	UPROPERTY(BlueprintAssignable, Category = "LlamaCpp")
+	FOnEmbeddingsComputed OnEmbeddingsComputed;
+
+	UPROPERTY(BlueprintAssignable, Category = "LlamaCpp")
+	FOnTextsClassified OnTextsClassified;
+
+private:
+	struct llama_model* Model = nullptr;
+	struct llama_context* Ctx = nullptr;
+	const struct llama_vocab* Vocab = nullptr;
+	int32 EmbeddingSize = 0;
+	uint64 ModelIdentity = 0;
+	bool bRankPooling = false;
+	TArray<FString> ClassLabels;
+
+	/** Guards Model/Ctx against concurrent EmbedBlocking calls and unloading. */
+	FCriticalSection ContextLock;
+
+	TAtomic<int32> PendingEmbeds{0};
+	FEvent* EmbedDoneEvent = nullptr;
+
+	/** Run Work on a new thread. BeginDestroy waits for it, so Work may use this directly. */
+	void RunPendingWork(TUniqueFunction<void()> Work);
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Frame timing published from the game thread once per tick (registered by the module), read by
+ * inference workers so they can back off when the game is missing its frame budget. The published
+ * time is the longer of game-thread and render-thread work in the last frame, excluding idle and vsync
+ * waits, so it stays below the refresh period while there is headroom.
+ */
+struct LLAMACPP_API FLlamaFrameBudget
+{
+	/** Game thread only. */
+	static void Publish(float WorkSeconds);
+
+	/** Work time of the last completed frame, in milliseconds. 0 until the first tick. */
+	static float GetFrameTimeMs();
+
+	/** Increments every published frame. */
+	static uint64 GetFrameCounter();
+
+	/** Sleep the calling thread until the next frame is published or MaxWaitSeconds has passed. */
+	static void WaitForNextFrame(float MaxWaitSeconds);
+};
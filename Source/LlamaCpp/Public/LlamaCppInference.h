@@ -2,8 +2,25 @@
 
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
+#include "Containers/StringView.h"
 #include "LlamaCppInference.generated.h"
 
+class ULlamaCppSemanticCache;
+class ULlamaConversation;
+class FLlamaGenerationCache;
+class FLlamaSamplerCache;
+class FLlamaTokenizerCache;
+class ULlamaCppLogitFilter;
+struct FLlamaCompiledLogitFilter;
+
+UENUM(BlueprintType)
+enum class ELlamaMirostat : uint8
+{
+	Off,
+	V1,
+	V2
+};
+
 USTRUCT(BlueprintType)
 struct FLlamaSamplingParams
 {
@@ -23,11 +40,154 @@ struct FLlamaSamplingParams
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
 	float RepeatPenalty = 1.1f;
+
+	/** Seed for the random sampling stages. Negative draws a new seed per request; a fixed seed makes replies reproducible. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 Seed = -1;
+
+	/** Recent tokens the repeat, frequency and presence penalties look at (-1 = context size, 0 = disabled). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 PenaltyLastN = 64;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	float FrequencyPenalty = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	float PresencePenalty = 0.0f;
+
+	/** DRY repetition penalty strength, 0 to disable. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp|DRY")
+	float DryMultiplier = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp|DRY")
+	float DryBase = 1.75f;
+
+	/** Repeated sequences up to this long are not penalized. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp|DRY")
+	int32 DryAllowedLength = 2;
+
+	/** Recent tokens DRY scans (-1 = context size). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp|DRY")
+	int32 DryPenaltyLastN = -1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp|DRY")
+	TArray<FString> DrySequenceBreakers = { TEXT("\n"), TEXT(":"), TEXT("\""), TEXT("*") };
+
+	/** Chance that XTC removes the most likely tokens above XtcThreshold, 0 to disable. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp|XTC")
+	float XtcProbability = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp|XTC")
+	float XtcThreshold = 0.1f;
+
+	/** Mirostat replaces top-k, top-p, min-p and XTC with a target-surprise sampler. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp|Mirostat")
+	ELlamaMirostat Mirostat = ELlamaMirostat::Off;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp|Mirostat")
+	float MirostatTau = 5.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp|Mirostat")
+	float MirostatEta = 0.1f;
+
+	/** Per-character logit biases and banned phrases, compiled when a request starts and reused while unchanged. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	ULlamaCppLogitFilter* LogitFilter = nullptr;
+
+	// LogitFilter compiled for the loaded model; filled in on the game thread when a request starts
+	TSharedPtr<const FLlamaCompiledLogitFilter, ESPMode::ThreadSafe> CompiledLogitFilter;
+};
+
+USTRUCT(BlueprintType)
+struct FLlamaOptionScore
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	FString Option;
+
+	/** Sum of the log-probabilities of the option's tokens given the prompt. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	float LogLikelihood = 0.0f;
+
+	/** LogLikelihood divided by NumTokens, so long and short options compare fairly. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	float NormalizedLogLikelihood = 0.0f;
+
+	/** Softmax of NormalizedLogLikelihood across all scored options. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	float Probability = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 NumTokens = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FLlamaPromptFragment
+{
+	GENERATED_BODY()
+
+	/** Appended as-is; include any separators such as newlines. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	FString Text;
+
+	/** When the budget is tight, fragments with the lowest priority are dropped first. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 Priority = 0;
+};
+
+UENUM(BlueprintType)
+enum class ELlamaRequestPriority : uint8
+{
+	Background,
+	Normal,
+	Interactive
+};
+
+/**
+ * Native streaming callbacks for ULlamaCppInference::StartGeneration. Both run on the generation
+ * worker thread, never the game thread, and the views are only valid during the call.
+ */
+struct FLlamaStreamCallbacks
+{
+	/**
+	 * Tokens sampled since the previous call and their UTF-8 text. Text always ends on a complete code
+	 * point, so one call can carry several tokens. Entropy is the last token's, if bMeasureTokenEntropy is set.
+	 */
+	TFunction<void(TArrayView<const int32> Tokens, FUtf8StringView Text, float Entropy)> OnTokens;
+
+	/**
+	 * Every generated token and the whole text, called once the context has been released.
+	 * bCompleted is false if the reply was cancelled, hit the deadline or failed.
+	 */
+	TFunction<void(TArrayView<const int32> Tokens, FUtf8StringView Text, bool bCompleted)> OnComplete;
+};
+
+/** Handle to a generation started with ULlamaCppInference::StartGeneration. Safe to use from any thread. */
+class FLlamaGenerationRequest
+{
+public:
+	/** Stop at the next token; OnComplete still fires with what was generated. */
+	void Cancel() { bCancelled = true; }
+
+	bool IsCancelled() const { return bCancelled; }
+
+	/** True once the worker has finished with the context, just before OnComplete. */
+	bool IsDone() const { return bDone; }
+
+private:
+	friend class ULlamaCppInference;
+
+	TAtomic<bool> bCancelled{false};
+	TAtomic<bool> bDone{false};
 };
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnTokenGenerated, const FString&, Token);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnGenerationComplete, const FString&, FullText);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnModelLoaded, bool, bSuccess);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnRequestTokenGenerated, int32, RequestId, const FString&, Token);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnRequestComplete, int32, RequestId, const FString&, FullText);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnOptionsScored, const TArray<FLlamaOptionScore>&, Scores, int32, BestIndex);
 
 UCLASS(BlueprintType, Blueprintable)
 class LLAMACPP_API ULlamaCppInference : public UObject
@@ -47,12 +207,170 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
 	bool IsModelLoaded() const;
 
+	/** True while any generation, scoring or queued request is using the context. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
+	bool IsGenerating() const { return bIsGenerating; }
+
+	/**
+	 * Number of tokens Text tokenizes to, or -1 without a model. Results are cached per text (LRU), so
+	 * recurring fragments like system prompts and lore chunks are only tokenized once. Safe to call from
+	 * any thread while the model stays loaded; does not wait for a running generation.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	int32 CountTokens(const FString& Text, bool bAddSpecial = false);
+
+	/** Tokenize Text with the loaded vocab, through the same cache as CountTokens. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	bool Tokenize(const FString& Text, TArray<int32>& OutTokens, bool bAddSpecial = false);
+
+	/**
+	 * Concatenate Fragments in their original order, leaving out the lowest-priority ones until the
+	 * prompt fits in ContextSize - MaxTokens, so a reply of MaxTokens never overflows the context.
+	 * Among equal priorities earlier fragments go first (older history before newer). The result is
+	 * checked against an exact count of the assembled prompt; OutNumTokens receives that count.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	FString BuildPromptWithinBudget(const TArray<FLlamaPromptFragment>& Fragments, int32 MaxTokens, int32& OutNumTokens);
+
+	/** Memory bound for CountTokens/Tokenize's fragment cache. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int64 TokenizerCacheMaxBytes = 1024 * 1024;
+
+	/**
+	 * Native streaming generation for C++ callers, without UObject events or per-token FStrings.
+	 * Callbacks run on the worker thread. Returns null (and calls nothing) if no model is loaded or the
+	 * context is busy. Call from the game thread; the Blueprint Generate calls are built on this.
+	 */
+	TSharedPtr<FLlamaGenerationRequest, ESPMode::ThreadSafe> StartGeneration(const FString& Prompt, int32 MaxTokens,
+		const FLlamaSamplingParams& SamplingParams, FLlamaStreamCallbacks Callbacks);
+
+	/** StartGeneration for an already tokenized prompt, e.g. from ULlamaConversation::BuildPromptTokens. */
+	TSharedPtr<FLlamaGenerationRequest, ESPMode::ThreadSafe> StartGeneration(TArray<int32> PromptTokens, int32 MaxTokens,
+		const FLlamaSamplingParams& SamplingParams, FLlamaStreamCallbacks Callbacks);
+
 	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
 	void GenerateTextAsync(const FString& Prompt, int32 MaxTokens = 256, FLlamaSamplingParams SamplingParams = FLlamaSamplingParams());
 
+	/**
+	 * Like GenerateTextAsync, but first embeds UserTurn (the player's last line) and looks it up in
+	 * SemanticCache within CacheScope. On a hit the stored response is delivered immediately as a single
+	 * OnTokenGenerated followed by OnGenerationComplete; on a miss the completed response is stored.
+	 * Falls back to GenerateTextAsync when no cache with a loaded embedder is set.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void GenerateTextCachedAsync(const FString& Prompt, const FString& UserTurn, const FString& CacheScope,
+		int32 MaxTokens = 256, FLlamaSamplingParams SamplingParams = FLlamaSamplingParams());
+
+	/**
+	 * Generate the next assistant reply for Conversation. Only turns appended since the last call are
+	 * tokenized, and the KV cache for the unchanged history is reused. With bAppendReply the finished
+	 * reply is added to the conversation before OnGenerationComplete fires.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void GenerateConversationAsync(ULlamaConversation* Conversation, int32 MaxTokens = 256,
+		FLlamaSamplingParams SamplingParams = FLlamaSamplingParams(), bool bAppendReply = true);
+
+	/**
+	 * Speculatively prefill the KV cache with a prompt built from a partial transcript (e.g. from
+	 * OnPartialTranscription) while the player is still talking. Tokens shared with what is already
+	 * cached are kept, a revised tail is rolled back, and the last PrefillHoldbackTokens are left out.
+	 * A later Generate call whose prompt starts the same way then only decodes the remainder.
+	 * Ignored while generating; each call supersedes the previous one, and a Generate call interrupts
+	 * a running prefill at the next chunk boundary.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void PrefillPartialAsync(const FString& PartialPrompt);
+
+	/** PrefillPartialAsync for Conversation plus a user message with PartialUserText, which is not added to it. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void PrefillConversationAsync(ULlamaConversation* Conversation, const FString& PartialUserText);
+
+	/** Stop the running generation and cancel every queued request. */
 	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
 	void StopGeneration();
 
+	/**
+	 * Queue a generation and return its request id; results fire via OnRequestTokenGenerated and
+	 * OnRequestComplete. Queued requests run one at a time, highest priority first. A request with a
+	 * higher priority than the running one preempts it at the next token: the running sequence is saved
+	 * with llama_state_seq_get_data, the urgent request is served, then the sequence is restored and the
+	 * preempted request resumes where it left off. Requests started with the other Generate calls are
+	 * not preemptible; queued requests wait for them to finish.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	int32 EnqueueGeneration(const FString& Prompt, int32 MaxTokens = 256, FLlamaSamplingParams SamplingParams = FLlamaSamplingParams(),
+		ELlamaRequestPriority Priority = ELlamaRequestPriority::Normal);
+
+	/** Cancel a queued or running request. A request that had not started completes with empty text. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void CancelRequest(int32 RequestId);
+
+	/**
+	 * Score how likely each option is as a continuation of Prompt. The prompt is prefilled once and
+	 * all options are evaluated together in one multi-sequence batch. Results fire via OnOptionsScored.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void ScoreOptionsAsync(const FString& Prompt, const TArray<FString>& Options);
+
+	/** Number of KV sequences the context is created with (minimum 2). Bounds how many options ScoreOptionsAsync evaluates per batch. Applied on LoadModel. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 MaxParallelSequences = 8;
+
+	/** Trailing prompt tokens speculative prefill leaves out, because the final transcript is likely to change them. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 PrefillHoldbackTokens = 4;
+
+	/** Tokens decoded per step by speculative prefill; bounds how long a Generate call waits for it to yield. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 PrefillChunkTokens = 32;
+
+	/** Response cache used by GenerateTextCachedAsync. Do not reassign while a generation is running. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	ULlamaCppSemanticCache* SemanticCache = nullptr;
+
+	/**
+	 * Keep generation within the game's frame budget: between decode steps the worker drops decode
+	 * threads (llama_set_n_threads) while frame work (game or render thread, excluding vsync waits)
+	 * runs over FrameBudgetMs, restores them below 80% of it, and waits a frame when already at MinDecodeThreads.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	bool bFrameBudgetScheduling = false;
+
+	/** Game- or render-thread work per frame, in milliseconds, above which generation backs off (13.9 = a full 72 Hz frame). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	float FrameBudgetMs = 13.9f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 MinDecodeThreads = 1;
+
+	/** Wall-clock limit per generation request in seconds, 0 for none. The reply ends with what was generated so far. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	float RequestDeadlineSeconds = 0.0f;
+
+	/** Compute the entropy of each token's predicted distribution during generation (costs one pass over the vocabulary per token). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	bool bMeasureTokenEntropy = false;
+
+	/**
+	 * Mean entropy (nats) of the tokens streamed so far by the current or last Generate call; a
+	 * low-confidence signal. Updated before each OnTokenGenerated. Requires bMeasureTokenEntropy.
+	 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
+	float GetMeanTokenEntropy() const;
+
+	/**
+	 * Replay the output of repeated deterministic requests (a fixed Seed, or Temperature <= 0 without XTC) instead of recomputing it.
+	 * Keyed by prompt tokens, sampling params, MaxTokens and model identity.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	bool bEnableExactCache = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int64 ExactCacheMaxBytes = 4 * 1024 * 1024;
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void ClearExactCache();
+
 	UPROPERTY(BlueprintAssignable, Category = "LlamaCpp")
 	FOnTokenGenerated OnTokenGenerated;
 
@@ -62,14 +380,88 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "LlamaCpp")
 	FOnModelLoaded OnModelLoaded;
 
+	UPROPERTY(BlueprintAssignable, Category = "LlamaCpp")
+	FOnOptionsScored OnOptionsScored;
+
+	UPROPERTY(BlueprintAssignable, Category = "LlamaCpp")
+	FOnRequestTokenGenerated OnRequestTokenGenerated;
+
+	UPROPERTY(BlueprintAssignable, Category = "LlamaCpp")
+	FOnRequestComplete OnRequestComplete;
+
 private:
 	struct llama_model* Model = nullptr;
 	struct llama_context* Ctx = nullptr;
 	const struct llama_vocab* Vocab = nullptr;
 	int32 CachedContextSize = 2048;
 
-	TAtomic<bool> bCancelGeneration{false};
 	TAtomic<bool> bIsGenerating{false};
 
+	// Request started by the last StartGeneration/Generate call; StopGeneration cancels it. Game thread.
+	TSharedPtr<FLlamaGenerationRequest, ESPMode::ThreadSafe> ActiveStream;
+
+	TSharedPtr<FLlamaGenerationRequest, ESPMode::ThreadSafe> StartGenerationInternal(const FString& Prompt, TArray<int32>&& PromptTokens,
+		int32 MaxTokens, const FLlamaSamplingParams& SamplingParams, FLlamaStreamCallbacks&& Callbacks);
+
+	/** Params with LogitFilter compiled for the loaded model. Game thread. */
+	FLlamaSamplingParams ResolveSamplingParams(const FLlamaSamplingParams& SamplingParams) const;
+
+	/** Callbacks that forward a native stream to OnTokenGenerated/OnGenerationComplete, running OnGameThreadComplete first. */
+	FLlamaStreamCallbacks MakeEventCallbacks(TFunction<void(const FString&)> OnGameThreadComplete);
+
 	FEvent* GenerationDoneEvent = nullptr;
+
+	// Tokens currently held in KV sequence 0; only touched by the worker holding ContextLock or while idle
+	TArray<int32> KvTokens;
+
+	// Held by whichever worker is using Ctx, so a speculative prefill and a request never overlap
+	FCriticalSection ContextLock;
+
+	// --- Speculative prefill ---
+	TAtomic<int32> PrefillSerial{0};
+	TAtomic<int32> NumPrefillWorkers{0};
+
+	/** Prefill Tokens, or PartialPrompt tokenized on the worker when Tokens is empty. */
+	void StartPrefill(const FString& PartialPrompt, TArray<int32>&& Tokens);
+
+	TSharedPtr<FLlamaGenerationCache, ESPMode::ThreadSafe> ExactCache;
+
+	// Sampler chains reused across requests; emptied when the model changes
+	TSharedPtr<FLlamaSamplerCache, ESPMode::ThreadSafe> SamplerCache;
+
+	TSharedPtr<FLlamaTokenizerCache, ESPMode::ThreadSafe> TokenizerCache;
+
+	/** Returns the exact-match cache with current limits applied, or null if disabled. */
+	FLlamaGenerationCache* GetExactCache();
+
+	// Game thread only
+	float TokenEntropySum = 0.0f;
+	int32 TokenEntropyCount = 0;
+
+	void ResetTokenEntropy();
+	void RecordTokenEntropy(float Entropy);
+
+	// --- Priority queue (EnqueueGeneration) ---
+	struct FQueuedRequest;
+
+	FCriticalSection QueueLock;
+	TArray<TSharedPtr<FQueuedRequest>> PendingRequests;
+	// Running request last, the requests it preempted before it
+	TArray<TSharedPtr<FQueuedRequest>> ActiveRequests;
+	TAtomic<bool> bPreemptRequested{false};
+	int32 NextRequestId = 1;
+
+	// Reused buffers for saved sequence state; worker thread only
+	TArray<TArray<uint8>> StateBufferPool;
+
+	/** Start the queue worker if requests are waiting and the context is idle. Game thread. */
+	void PumpRequestQueue();
+
+	/** Remove and return the best pending request with at least MinPriority. Caller holds QueueLock. */
+	TSharedPtr<FQueuedRequest> PopPendingRequest(int32 MinPriority);
+
+	void RunQueuedRequest(const TSharedPtr<FQueuedRequest>& Request);
+
+	/** Save sequence 0, run every pending request that outranks the active one, then restore it. */
+	void ServicePreemption();
 };
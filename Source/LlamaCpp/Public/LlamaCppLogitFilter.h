@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "LlamaCppLogitFilter.generated.h"
+
+struct FLlamaCompiledLogitFilter;
+
+USTRUCT(BlueprintType)
+struct FLlamaLogitBias
+{
+	GENERATED_BODY()
+
+	/** Text whose tokens are biased. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	FString Text;
+
+	/** Added to the logit of each token of Text. Large negative values all but forbid them. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	float Bias = 0.0f;
+};
+
+/**
+ * Words a character should favour or never say, e.g. profanity or out-of-world terms.
+ *
+ * Compiled once per model into token sequences: biases become a llama_sampler_init_logit_bias stage,
+ * single-token banned phrases a -inf bias, and longer ones a small sampler that forbids the token
+ * which would complete a phrase. Compilation is redone only when the lists change. Attach to
+ * FLlamaSamplingParams::LogitFilter; one filter can be shared by every request for a character.
+ */
+UCLASS(BlueprintType, Blueprintable)
+class LLAMACPP_API ULlamaCppLogitFilter : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	TArray<FLlamaLogitBias> Biases;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	TArray<FString> BannedPhrases;
+
+	/** Also match each text with a leading space and with its first letter capitalized, as it appears mid-sentence or at its start. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	bool bMatchVariants = true;
+
+	/** Compiled form for Model, reusing the last result if neither the model nor the lists changed. Game thread. */
+	TSharedPtr<const FLlamaCompiledLogitFilter, ESPMode::ThreadSafe> Compile(const struct llama_model* Model);
+
+private:
+	const struct llama_model* CompiledModel = nullptr;
+	uint64 CompiledSourceHash = 0;
+	TSharedPtr<const FLlamaCompiledLogitFilter, ESPMode::ThreadSafe> Compiled;
+
+	uint64 HashSource() const;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Modules/ModuleManager.h"
+#include "Containers/Ticker.h"
 
 class FLlamaCppModule : public IModuleInterface
 {
@@ -10,6 +11,7 @@ public:
 
 private:
 	TArray<void*> LoadedLibHandles;
+	FTSTicker::FDelegateHandle FrameBudgetTickerHandle;
 
 	bool LoadSharedLibrary(const FString& LibName);
 	void FreeLoadedLibraries();
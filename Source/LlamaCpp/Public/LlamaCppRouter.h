@@ -0,0 +1,154 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "LlamaCppInference.h"
+#include "LlamaCppRouter.generated.h"
+
+UENUM(BlueprintType)
+enum class ELlamaRoutingMode : uint8
+{
+	/** Only Rules decide; unmatched queries go to DefaultTier. */
+	RulesOnly,
+	/** Ask the smallest model whether the query is hard (ScoreOptionsAsync) and escalate if it thinks so. */
+	Classifier,
+	/** Start on the smallest model and escalate if its mean token entropy is too high. */
+	Confidence
+};
+
+USTRUCT(BlueprintType)
+struct FLlamaRoutingRule
+{
+	GENERATED_BODY()
+
+	/** Rule matches if the query contains any of these (case-insensitive). Empty matches any query. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	TArray<FString> Keywords;
+
+	/** Rule only matches queries at least this long. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 MinQueryLength = 0;
+
+	/** Index into ULlamaCppRouter::Tiers. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 Tier = 0;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnRouteSelected, int32, Tier);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnRoutedGenerationComplete, const FString&, FullText, int32, Tier);
+
+/**
+ * Sends each query to the cheapest of several loaded models that can handle it.
+ *
+ * Tiers are ordered smallest to largest and must be loaded by the caller. Rules are checked first;
+ * otherwise Mode decides between the smallest tier and an escalation to the largest. Events mirror
+ * ULlamaCppInference and report the tier that produced the reply. One request at a time.
+ */
+UCLASS(BlueprintType, Blueprintable)
+class LLAMACPP_API ULlamaCppRouter : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	TArray<ULlamaCppInference*> Tiers;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	ELlamaRoutingMode Mode = ELlamaRoutingMode::Confidence;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	TArray<FLlamaRoutingRule> Rules;
+
+	/** Tier used in RulesOnly mode when no rule matches. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 DefaultTier = 0;
+
+	/** Classifier prompt; "{query}" is replaced with the query. Followed by EasyLabel or HardLabel. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	FString ClassifierPrompt = TEXT("Question: {query}\nCan this be answered with a short, simple reply? Answer:");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	FString EasyLabel = TEXT(" yes");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	FString HardLabel = TEXT(" no");
+
+	/** Escalate when the classifier's probability for HardLabel is at least this. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	float HardThreshold = 0.5f;
+
+	/** Escalate when the small model's mean token entropy (nats) exceeds this. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	float MaxMeanEntropy = 2.0f;
+
+	/**
+	 * In Confidence mode the small model's first tokens are held back until this many have been
+	 * generated; only then is the entropy judged and the reply either streamed or escalated.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 EntropyWindowTokens = 8;
+
+	/**
+	 * Route and generate. Prompt is the full prompt sent to the model; Query is the text rules and the
+	 * classifier look at (typically the player's line). An empty Query uses Prompt.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void GenerateAsync(const FString& Prompt, const FString& Query, int32 MaxTokens = 256,
+		FLlamaSamplingParams SamplingParams = FLlamaSamplingParams());
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void StopGeneration();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
+	bool IsBusy() const { return ActiveTier != INDEX_NONE || bClassifying; }
+
+	/** Requests answered by each tier. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
+	TArray<int32> GetRequestsPerTier() const { return RequestsPerTier; }
+
+	/** Requests the classifier or confidence check sent past the smallest tier. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
+	int32 GetEscalationCount() const { return Escalations; }
+
+	UPROPERTY(BlueprintAssignable, Category = "LlamaCpp")
+	FOnRouteSelected OnRouteSelected;
+
+	UPROPERTY(BlueprintAssignable, Category = "LlamaCpp")
+	FOnTokenGenerated OnTokenGenerated;
+
+	UPROPERTY(BlueprintAssignable, Category = "LlamaCpp")
+	FOnRoutedGenerationComplete OnGenerationComplete;
+
+private:
+	FString PendingPrompt;
+	int32 PendingMaxTokens = 256;
+	FLlamaSamplingParams PendingParams;
+
+	int32 ActiveTier = INDEX_NONE;
+	bool bClassifying = false;
+	bool bJudgingConfidence = false;
+	bool bEscalating = false;
+	bool bStopped = false;
+	/** Tier whose bMeasureTokenEntropy the confidence check turned on, and its own value to put back. */
+	int32 EntropyOverrideTier = INDEX_NONE;
+	bool bSavedMeasureTokenEntropy = false;
+	int32 HeldTokenCount = 0;
+	FString HeldText;
+
+	TArray<int32> RequestsPerTier;
+	int32 Escalations = 0;
+
+	int32 MatchRule(const FString& Query) const;
+	void StartTier(int32 Tier, bool bJudgeConfidence);
+	void FinishRequest(const FString& FullText);
+	void Escalate();
+
+	UFUNCTION()
+	void HandleClassified(const TArray<FLlamaOptionScore>& Scores, int32 BestIndex);
+
+	UFUNCTION()
+	void HandleToken(const FString& Token);
+
+	UFUNCTION()
+	void HandleComplete(const FString& FullText);
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "LlamaCppSemanticCache.generated.h"
+
+class ULlamaCppEmbedder;
+
+USTRUCT(BlueprintType)
+struct FLlamaCacheStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 Hits = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 Misses = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 Evictions = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 NumEntries = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int64 SizeBytes = 0;
+};
+
+/**
+ * Response cache keyed by the embedding of the player's final turn. A lookup hits when a stored entry
+ * in the same scope (e.g. "Character|State") has cosine similarity >= SimilarityThreshold.
+ * Entries are evicted least-recently-used first when MaxEntries or MaxSizeBytes is exceeded.
+ *
+ * Attach to ULlamaCppInference::SemanticCache and call GenerateTextCachedAsync. Thread-safe.
+ */
+UCLASS(BlueprintType, Blueprintable)
+class LLAMACPP_API ULlamaCppSemanticCache : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Embedding model used to embed user turns. Must be loaded with normalized output. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	ULlamaCppEmbedder* Embedder = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	float SimilarityThreshold = 0.92f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 MaxEntries = 1024;
+
+	/** Upper bound on vectors plus response text held in memory. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int64 MaxSizeBytes = 8 * 1024 * 1024;
+
+	/** Find the most similar entry in Scope. Updates hit/miss stats and LRU order. */
+	bool Lookup(const FString& Scope, TArrayView<const float> Vector, FString& OutResponse);
+
+	void Insert(const FString& Scope, TArrayView<const float> Vector, const FString& Response);
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void Clear();
+
+	/** Remove every entry in Scope, e.g. when a character's state changes in a way that invalidates replies. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void ClearScope(const FString& Scope);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
+	FLlamaCacheStats GetStats() const;
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void ResetStats();
+
+	/** Records Embedder's model and dimension with the entries, so Embedder must be loaded. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	bool SaveToFile(const FString& FilePath) const;
+
+	/** Fails unless Embedder is loaded with the same model the file was saved with. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	bool LoadFromFile(const FString& FilePath);
+
+private:
+	struct FEntry
+	{
+		FString Scope;
+		TArray<float> Vector;
+		FString Response;
+		uint64 LastUsed = 0;
+
+		int64 GetSizeBytes() const
+		{
+			return sizeof(FEntry) + Vector.Num() * sizeof(float) + (Scope.Len() + Response.Len()) * sizeof(TCHAR);
+		}
+	};
+
+	TArray<FEntry> Entries;
+	int64 SizeBytes = 0;
+	uint64 UseCounter = 0;
+	FLlamaCacheStats Stats;
+
+	mutable FCriticalSection CacheLock;
+
+	void EvictToFit();
+};
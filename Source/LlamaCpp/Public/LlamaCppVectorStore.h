@@ -0,0 +1,131 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "LlamaCppEmbedder.h"
+#include "LlamaCppVectorStore.generated.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+USTRUCT(BlueprintType)
+struct FLlamaVectorSearchResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 Index = INDEX_NONE;
+
+	/** Dot product between query and stored vector (cosine similarity for normalized vectors). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	float Score = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	FString Text;
+};
+
+/**
+ * In-process nearest-neighbour store for retrieval-augmented prompts.
+ *
+ * Vectors live in one contiguous, 64-byte aligned block (row stride padded to a multiple of 8 floats),
+ * with their texts in a parallel array. Optionally vectors are stored as int8 with a per-row scale.
+ * Search is a flat SIMD scan, or an IVF scan over the closest clusters once BuildIvfIndex has run.
+ * SaveToFile writes a layout that LoadFromFile memory-maps, so loading does not copy the vectors.
+ *
+ * Searches may run on any thread; mutations take a write lock.
+ */
+UCLASS(BlueprintType, Blueprintable)
+class LLAMACPP_API ULlamaCppVectorStore : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void BeginDestroy() override;
+
+	/** Reset the store for vectors of the given size. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void Initialize(int32 InDimension, bool bInQuantizeInt8 = false);
+
+	/** Append a vector and its text. Returns the new index, or INDEX_NONE if the size does not match. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	int32 Add(const FLlamaEmbedding& Embedding, const FString& Text);
+
+	int32 AddVector(TArrayView<const float> Vector, const FString& Text);
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void Empty();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
+	int32 Num() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LlamaCpp")
+	int32 GetDimension() const { return Dimension; }
+
+	/** Return the K entries with the highest dot product to Query, best first. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	TArray<FLlamaVectorSearchResult> Search(const FLlamaEmbedding& Query, int32 K = 5) const;
+
+	TArray<FLlamaVectorSearchResult> SearchVector(TArrayView<const float> Query, int32 K = 5) const;
+
+	/**
+	 * Cluster the stored vectors into InNumLists inverted lists (spherical k-means on a sample).
+	 * InNumLists <= 0 picks sqrt(Num()). Afterwards searches only scan the NumProbes closest lists.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	void BuildIvfIndex(int32 InNumLists = 0, int32 Iterations = 8);
+
+	/** Inverted lists scanned per query once an IVF index exists. Higher is more accurate and slower. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "LlamaCpp")
+	int32 NumProbes = 8;
+
+	/**
+	 * Retrieve the top K texts for Query and substitute them for "{context}" in PromptTemplate,
+	 * joined by Separator. The result can be passed directly to GenerateTextAsync.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	FString BuildAugmentedPrompt(const FLlamaEmbedding& Query, const FString& PromptTemplate, int32 K = 3, const FString& Separator = TEXT("\n"));
+
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	bool SaveToFile(const FString& FilePath) const;
+
+	/** Memory-map a file written by SaveToFile. Vectors stay in the mapping until the store is modified. */
+	UFUNCTION(BlueprintCallable, Category = "LlamaCpp")
+	bool LoadFromFile(const FString& FilePath);
+
+private:
+	int32 Dimension = 0;
+	int32 Stride = 0;
+	bool bQuantizeInt8 = false;
+	int32 Count = 0;
+
+	// Owned storage, used unless a mapping is active
+	TArray<float, TAlignedHeapAllocator<64>> FloatStorage;
+	TArray<int8, TAlignedHeapAllocator<64>> Int8Storage;
+	TArray<float> ScaleStorage;
+
+	// Views the search kernels read from; point into owned storage or the mapped file
+	const float* FloatData = nullptr;
+	const int8* Int8Data = nullptr;
+	const float* Scales = nullptr;
+
+	TArray<FString> Texts;
+
+	// IVF index: centroid rows use the same stride as the vectors
+	int32 NumLists = 0;
+	TArray<float, TAlignedHeapAllocator<64>> Centroids;
+	TArray<int32> ListOffsets;
+	TArray<int32> ListMembers;
+
+	IMappedFileHandle* MappedHandle = nullptr;
+	IMappedFileRegion* MappedRegion = nullptr;
+
+	mutable FRWLock StoreLock;
+
+	/** Initialize with StoreLock already held for writing. */
+	void ResetLocked(int32 InDimension, bool bInQuantizeInt8);
+
+	void ReleaseMapping();
+	void DetachFromMapping();
+	void RefreshViews();
+	void ScoreRow(int32 Row, const float* QueryF, const int8* QueryQ, float QueryScale, TArray<TPair<float, int32>>& Heap, int32 K) const;
+};
@@ -40,6 +40,10 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "SherpaOnnxTTS")
 	bool IsSpeaking() const;
 
+	/** Resample generated speech to this rate before playback (e.g. the audio device rate). 0 keeps the model's rate. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SherpaOnnxTTS", meta = (ClampMin = "0"))
+	int32 OutputSampleRate = 0;
+
 	UPROPERTY(BlueprintAssignable, Category = "SherpaOnnxTTS")
 	FOnTtsModelLoaded OnModelLoaded;
 
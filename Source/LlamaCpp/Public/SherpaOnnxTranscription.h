@@ -7,6 +7,7 @@
 
 struct SherpaOnnxOnlineRecognizer;
 struct SherpaOnnxOnlineStream;
+class FLlamaAudioResampler;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnSherpaAsrModelLoaded, bool, bSuccess);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnSherpaTranscriptionText, const FString&, Text);
@@ -65,9 +66,13 @@ private:
 	TAtomic<bool> bIsBeingDestroyed{false};
 	TAtomic<bool> bIsCapturing{false};
 
+	/** 16kHz mono audio waiting for the decode loop. */
 	TArray<float> AudioBuffer;
 	FCriticalSection AudioBufferLock;
 
+	/** Converts device audio to 16kHz mono; only touched by the capture callback. */
+	TSharedPtr<FLlamaAudioResampler, ESPMode::ThreadSafe> CaptureResampler;
+
 	class Audio::FAudioCapture* AudioCapture = nullptr;
 
 	void DecodeLoop();
@@ -6,6 +6,10 @@
 #include "WhisperCppTranscription.generated.h"
 
 struct whisper_context;
+struct whisper_vad_context;
+class FWhisperAudioRingBuffer;
+class FWhisperStatePool;
+class FWhisperJobQueue;
 
 USTRUCT(BlueprintType)
 struct FWhisperTranscriptionSegment
@@ -37,9 +41,65 @@ struct FWhisperTranscriptionResult
 	bool bSuccess = false;
 };
 
+USTRUCT(BlueprintType)
+struct FWhisperTranscriptionOptions
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper")
+	FString Language = TEXT("en");
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper")
+	bool bSingleSegment = false;
+
+	/** Skip silence with the loaded VAD model, if any. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper")
+	bool bUseVad = true;
+};
+
+/** Aggregate numbers for the EnqueueTranscription queue since the last ResetQueueStats. */
+USTRUCT(BlueprintType)
+struct FWhisperQueueStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper")
+	int32 NumPending = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper")
+	int32 NumWorkers = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper")
+	int32 NumCompleted = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper")
+	int32 NumFailed = 0;
+
+	/** Length of the audio in completed jobs. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper")
+	float AudioSeconds = 0.0f;
+
+	/** Sum of per-job decode times; exceeds WallSeconds when workers overlap. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper")
+	float DecodeSeconds = 0.0f;
+
+	/** Time during which at least one worker was running. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper")
+	float WallSeconds = 0.0f;
+
+	/** AudioSeconds / WallSeconds: seconds of audio transcribed per second of queue time. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper")
+	float RealtimeFactor = 0.0f;
+};
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnWhisperModelLoaded, bool, bSuccess);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnTranscriptionComplete, const FWhisperTranscriptionResult&, Result);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPartialTranscription, const FString&, PartialText);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnWhisperJobComplete, int32, JobId, const FWhisperTranscriptionResult&, Result);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnWhisperTranscriptionProgress, int32, ProgressPercent);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnWhisperSegmentTranscribed, const FWhisperTranscriptionSegment&, Segment);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnWhisperUtteranceStarted);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnWhisperUtteranceEnded, const FString&, UtteranceText);
 
 UCLASS(BlueprintType, Blueprintable)
 class LLAMACPP_API UWhisperCppTranscription : public UObject
@@ -50,8 +110,13 @@ public:
 	UWhisperCppTranscription();
 	virtual void BeginDestroy() override;
 
+	/**
+	 * Load a whisper model, and optionally a Silero VAD model (ggml format). With VAD loaded, realtime
+	 * transcription only decodes while someone is speaking and reports utterance start and end, and
+	 * file and push-to-talk transcription skip silence.
+	 */
 	UFUNCTION(BlueprintCallable, Category = "Whisper")
-	void LoadModel(const FString& ModelPath);
+	void LoadModel(const FString& ModelPath, const FString& VadModelPath = TEXT(""));
 
 	UFUNCTION(BlueprintCallable, Category = "Whisper")
 	void UnloadModel();
@@ -59,9 +124,37 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Whisper")
 	bool IsModelLoaded() const;
 
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Whisper")
+	bool IsVadModelLoaded() const;
+
 	UFUNCTION(BlueprintCallable, Category = "Whisper")
 	void TranscribeWavFileAsync(const FString& WavFilePath, const FString& Language = TEXT("en"));
 
+	/**
+	 * Transcribe a WAV file of any length. The file is streamed from disk and cut into chunks of about
+	 * LongFormChunkSeconds at pauses (VAD gaps when a VAD model is loaded, the quietest stretch otherwise).
+	 * Chunks decode in parallel on the decoder state pool; OnSegmentTranscribed fires for each segment in
+	 * file order with file-relative times, and OnTranscriptionComplete carries everything at the end.
+	 * Memory stays bounded by MaxConcurrentTranscriptions chunks regardless of file length.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Whisper")
+	void TranscribeLongWavFileAsync(const FString& WavFilePath, const FString& Language = TEXT("en"));
+
+	/**
+	 * Queue a WAV file for transcription and return its job id. Up to NumQueueWorkers files decode at
+	 * once over the shared model; OnJobComplete fires with the id when each one finishes, in completion
+	 * order. Jobs never reject each other. StopTranscription fails everything still queued.
+	 * Returns INDEX_NONE if no model is loaded.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Whisper|Queue")
+	int32 EnqueueTranscription(const FString& WavFilePath, const FWhisperTranscriptionOptions& Options);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Whisper|Queue")
+	FWhisperQueueStats GetQueueStats() const;
+
+	UFUNCTION(BlueprintCallable, Category = "Whisper|Queue")
+	void ResetQueueStats();
+
 	UFUNCTION(BlueprintCallable, Category = "Whisper")
 	void StartMicrophoneCapture();
 
@@ -71,9 +164,23 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Whisper")
 	bool IsCapturing() const;
 
+	/** Abort running file, push-to-talk, long-form and queued transcriptions. Decodes stop within a graph node. */
 	UFUNCTION(BlueprintCallable, Category = "Whisper")
 	void StopTranscription();
 
+	/** The audio_ctx the current policy would use for a clip of ClipSeconds; 0 means the model's full context. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Whisper|AudioContext")
+	int32 GetAudioContextForClip(float ClipSeconds) const;
+
+	/** Captured samples lost since capture started because a reader fell a full buffer behind. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Whisper")
+	int64 GetDroppedCaptureSamples() const;
+
+	/**
+	 * Transcribe the microphone while it records. Each tick decodes only the audio that has not been
+	 * committed yet (at most RealtimeMaxWindowSeconds). Words are committed once two consecutive passes
+	 * agree on them, broadcast through OnPartialTranscription, and fed back to whisper as the prompt.
+	 */
 	UFUNCTION(BlueprintCallable, Category = "Whisper")
 	void StartRealtimeTranscription(const FString& Language = TEXT("en"), float IntervalSeconds = 3.0f);
 
@@ -91,6 +198,79 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper")
 	bool bSingleSegment = false;
 
+	/**
+	 * Transcriptions that can decode at the same time over the one loaded model. Each needs its own
+	 * decoder state (KV caches and compute buffers, tens of MB for small models); further requests
+	 * wait for a free one. The realtime loop holds one for its whole session. Read by LoadModel; changing
+	 * it while a model is loaded has no effect until the next load.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper", meta = (ClampMin = "1"))
+	int32 MaxConcurrentTranscriptions = 2;
+
+	/**
+	 * Threads draining the EnqueueTranscription queue. Each decodes one file at a time with
+	 * MaxThreads / NumQueueWorkers whisper threads; several narrow decodes side by side keep cores busier
+	 * than one wide decode. Parallelism is also capped by MaxConcurrentTranscriptions.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper|Queue", meta = (ClampMin = "1"))
+	int32 NumQueueWorkers = 2;
+
+	/**
+	 * Length of the microphone ring buffer. Push-to-talk recordings longer than this keep only their
+	 * last MaxCaptureSeconds. The buffer is never smaller than RealtimeMaxWindowSeconds.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper", meta = (ClampMin = "1.0"))
+	float MaxCaptureSeconds = 30.0f;
+
+	/**
+	 * Longest stretch of uncommitted audio the realtime loop decodes per tick. If passes keep disagreeing
+	 * until the window is full, everything but the last word is committed so the window can move on.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper", meta = (ClampMin = "2.0", ClampMax = "30.0"))
+	float RealtimeMaxWindowSeconds = 15.0f;
+
+	/** Target chunk length for TranscribeLongWavFileAsync. Cuts land up to 5 seconds earlier, at a pause. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper", meta = (ClampMin = "10.0", ClampMax = "30.0"))
+	float LongFormChunkSeconds = 25.0f;
+
+	/**
+	 * Shrink the encoder's context to the clip length instead of always encoding 30 s, which dominates
+	 * latency for short commands. Applies to clips under 30 s in every mode; a slight accuracy cost near
+	 * the end of the clip is possible, which AudioContextMarginSeconds guards against. The log line after
+	 * each decode shows the context used and the time taken.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper|AudioContext")
+	bool bDynamicAudioContext = false;
+
+	/** Extra audio the shortened context covers beyond the end of the clip. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper|AudioContext", meta = (ClampMin = "0.0", ClampMax = "10.0"))
+	float AudioContextMarginSeconds = 1.0f;
+
+	/** Shortest context, in seconds of audio, used however short the clip. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper|AudioContext", meta = (ClampMin = "1.0", ClampMax = "30.0"))
+	float MinAudioContextSeconds = 3.0f;
+
+	/** Speech probability above which VAD treats a frame as speech. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper|VAD", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float VadThreshold = 0.5f;
+
+	/** Silence after speech that ends an utterance. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper|VAD", meta = (ClampMin = "0"))
+	int32 VadMinSilenceMs = 600;
+
+	/**
+	 * Compute the realtime window's log-mel spectrogram incrementally, transforming only audio that
+	 * arrived since the last tick, and hand it to whisper instead of letting it redo the whole window.
+	 * whisper cannot compute token timestamps without the samples, so word ends are estimated from
+	 * segment times and snapped to the quietest nearby 20 ms; commit points may be slightly less exact.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper")
+	bool bRealtimeIncrementalMel = false;
+
+	/** Most recent committed tokens passed to whisper as the prompt for the next realtime pass. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Whisper", meta = (ClampMin = "0", ClampMax = "224"))
+	int32 RealtimePromptTokens = 128;
+
 	UPROPERTY(BlueprintAssignable, Category = "Whisper")
 	FOnWhisperModelLoaded OnModelLoaded;
 
@@ -100,31 +280,64 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "Whisper")
 	FOnPartialTranscription OnPartialTranscription;
 
+	/** A job from EnqueueTranscription finished (bSuccess is false if it failed or was cancelled). */
+	UPROPERTY(BlueprintAssignable, Category = "Whisper|Queue")
+	FOnWhisperJobComplete OnJobComplete;
+
+	/**
+	 * A segment as soon as whisper finishes it, before OnTranscriptionComplete. File and push-to-talk
+	 * transcription report times relative to the clip; long-form mode reports them in file order and
+	 * relative to the start of the file.
+	 */
+	UPROPERTY(BlueprintAssignable, Category = "Whisper")
+	FOnWhisperSegmentTranscribed OnSegmentTranscribed;
+
+	/** File and push-to-talk transcription: percentage of the clip decoded so far. */
+	UPROPERTY(BlueprintAssignable, Category = "Whisper")
+	FOnWhisperTranscriptionProgress OnTranscriptionProgress;
+
+	/** Realtime mode with VAD: speech began after silence. */
+	UPROPERTY(BlueprintAssignable, Category = "Whisper")
+	FOnWhisperUtteranceStarted OnUtteranceStarted;
+
+	/** Realtime mode with VAD: speech was followed by VadMinSilenceMs of silence. Carries the utterance's full text. */
+	UPROPERTY(BlueprintAssignable, Category = "Whisper")
+	FOnWhisperUtteranceEnded OnUtteranceEnded;
+
 private:
 	whisper_context* WhisperCtx = nullptr;
-
-	TAtomic<bool> bCancelTranscription{false};
-	TAtomic<bool> bIsTranscribing{false};
+	whisper_vad_context* VadCtx = nullptr;
+	TSharedPtr<FWhisperStatePool, ESPMode::ThreadSafe> StatePool;
+	TSharedPtr<FWhisperJobQueue, ESPMode::ThreadSafe> JobQueue;
+	FString LoadedVadModelPath;
+
+	/** Cancel flag of every job started since the last StopTranscription, which sets them all. Each job owns its own. */
+	FCriticalSection CancelTokensLock;
+	TArray<TSharedRef<TAtomic<bool>, ESPMode::ThreadSafe>> CancelTokens;
+	TAtomic<int32> NumActiveTranscriptions{0};
 	TAtomic<bool> bIsCapturing{false};
 	TAtomic<bool> bHasReceivedAudio{false};
 
-	TArray<float> CapturedAudioData;
-	FCriticalSection CapturedAudioLock;
+	TSharedPtr<FWhisperAudioRingBuffer, ESPMode::ThreadSafe> CaptureBuffer;
 	float CaptureSampleRate = 0.0f;
 	int32 CaptureNumChannels = 0;
 
 	class Audio::FAudioCapture* AudioCapture = nullptr;
 
+	/** New cancel flag for one job, registered with StopTranscription. */
+	TSharedRef<TAtomic<bool>, ESPMode::ThreadSafe> MakeCancelToken();
+
 	void RunTranscription(TArray<float> AudioData, const FString& Language, int32 NumThreads, bool bUseSingleSegment);
 	bool LoadWavFile(const FString& FilePath, TArray<float>& OutAudioData, int32& OutSampleRate, int32& OutNumChannels);
-	void ResampleTo16kMono(const TArray<float>& InData, int32 InSampleRate, int32 InNumChannels, TArray<float>& OutData);
 
 	void RealtimeTranscriptionLoop(FString Language, float IntervalSeconds);
+	void QueueWorkerLoop();
 
 	TAtomic<bool> bIsRealtimeTranscribing{false};
 	TAtomic<bool> bIsBeingDestroyed{false};
 	FString AccumulatedTranscription;
-	FString LastWindowText;
+	/** Text of the last realtime pass that has not been confirmed yet. */
+	FString PendingRealtimeText;
 
 	FEvent* TranscriptionDoneEvent = nullptr;
 	FEvent* RealtimeDoneEvent = nullptr;